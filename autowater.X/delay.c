@@ -0,0 +1,147 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Delay service
+//  - Short delays spin like __delay_ms().
+//  - With DELAY_SLEEP longer delays SLEEP and the WDT wakes up (WDTE = SWDTEN).
+//    Timer0 stops while sleeping, so TMR0 is advanced by the slept time
+//    afterwards and the timer interrupt keeps its pace.
+//  - The slept time is the period of the WDT measured against the RTC by
+//    delay_calibrate() and rounded down, so delays and the timer never run
+//    ahead of the time. Delays spin until it is measured (the boot waits).
+//  - With the interrupts disabled a flag of an enabled interrupt turns SLEEP
+//    into NOP, so delays spin as well.
+
+#include "hal.h"
+#include "rtc_8564nb.h"
+#include "delay.h"
+
+#ifdef DELAY_SLEEP
+// Naps of the calibration (1:32) in the window, and the counts of Timer0
+// of the window multiplied by 16 (the ratio of 1:512 to 1:32)
+#define DELAY_CAL_NAPS  (DELAY_CAL_COUNT * 15625UL * 16 / DELAY_WDT_MIN + 2)
+#define DELAY_CAL_TMR0  (DELAY_CAL_COUNT * 15625UL * 16 / DELAY_TMR0_US)
+
+volatile unsigned char delay_tick;
+unsigned char delay_wdt_tmr0;
+
+/**
+ * !@brief Sleep for a period of the WDT
+ *
+ * The MSSP stops in SLEEP, so the stop condition etc. is finished before.
+ * @param[in] wdtcon WDTCON with the prescaler (SWDTEN off)
+ * @return 1:woken up by the WDT 0:by an interrupt (or SLEEP was NOP)
+ */
+static char delay_nap(unsigned char wdtcon)
+{
+    while ((SSP1CON2 & 0x1f) != 0 || SSP1STATbits.R_nW) {
+        HAL_POLL();
+    }
+    CLRWDT();                   // nTO = 1 unless the WDT wakes up
+    WDTCON = wdtcon | 1;        // SWDTEN on
+    SLEEP();
+    NOP();
+    WDTCON = wdtcon;            // SWDTEN off
+    return (nTO == 0);
+}
+
+/**
+ * !@brief Wait for milliseconds
+ *
+ * An interrupt (e.g. button or alarm) wakes up before the WDT. The time of
+ * such a chunk is unknown, so it is not counted and the delay gets longer.
+ * The time is counted in 128us of Timer0 (rounded up).
+ * The timer interrupt must reload TMR0 by adding, not by writing.
+ * @param[in] ms Time to wait [ms], up to 8191
+ */
+void delay_ms(unsigned short ms)
+{
+    unsigned char t;
+    unsigned short n = (ms << 3) - ((ms * 3) >> 4); // ms * 7.8125 counts of Timer0
+
+    while (n >= delay_wdt_tmr0 && delay_wdt_tmr0 != 0 && GIE) {
+        if (delay_nap(DELAY_WDTCON)) {
+            n -= delay_wdt_tmr0;
+            t = TMR0 + delay_wdt_tmr0;
+            TMR0 = t;
+            if (t < delay_wdt_tmr0) {
+                TMR0IF = 1;         // overflowed while sleeping
+            }
+        }
+    }
+    while (n != 0) {
+        __delay_us(DELAY_TMR0_US);
+        n--;
+    }
+}
+
+/**
+ * !@brief Measure the period of the WDT by the repeated timer of the RTC
+ *
+ * After the first falling edge of /INT the naps of 1:32 (about 1ms) are
+ * counted until the next one, a period of the timer by the crystal. The
+ * counting starts up to a nap after the first edge and the last nap ends
+ * after the second one, so the period is taken short by up to two naps of
+ * the window (under 2%), never long.
+ * The IOC of /INT and the timer interrupt are off meanwhile. It gives up
+ * when /INT doesn't change in time (e.g. LO by the alarm) or an interrupt
+ * wakes up, then delay_wdt_tmr0 is kept. Timer0 is not advanced.
+ * @param[in] int_pin Bit of RTC /INT in PORTA
+ * @return 0:success others:failure
+ */
+char delay_calibrate(unsigned char int_pin)
+{
+    unsigned short n = 0;
+    unsigned short r;
+    unsigned char c = 0;
+    char ie = TMR0IE;
+
+    TMR0IE = 0;
+    IOCAN = IOCAN & ~int_pin;
+    if (rtc_start_repeated_timer(RTC_TIMER_64HZ, DELAY_CAL_COUNT) == 0 &&
+        (PORTA & int_pin) != 0) {
+        while ((PORTA & int_pin) != 0 && n < DELAY_CAL_NAPS &&
+               delay_nap(DELAY_CAL_WDTCON)) {
+            n++;
+        }
+        n = 0;
+        if ((PORTA & int_pin) == 0 && rtc_clear_timer() == 0) {
+            do {
+                n++;
+            } while ((PORTA & int_pin) != 0 && n < DELAY_CAL_NAPS &&
+                     delay_nap(DELAY_CAL_WDTCON));
+        }
+        if ((PORTA & int_pin) == 0 &&
+            n >= DELAY_CAL_TMR0 / (DELAY_WDT_MAX / DELAY_TMR0_US)) {
+            for (r = DELAY_CAL_TMR0; r >= n; r -= n) {
+                c++;                // c = DELAY_CAL_TMR0 / (naps + 1)
+            }
+            delay_wdt_tmr0 = c;
+        }
+    }
+    rtc_stop_repeated_timer();
+    IOCAF = IOCAF & ~int_pin;
+    IOCAN = IOCAN | int_pin;
+    TMR0IE = ie;
+    return (c == 0);
+}
+#endif
@@ -0,0 +1,74 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+#ifndef _DELAY_H_
+#define _DELAY_H_
+
+#ifndef _XTAL_FREQ
+// Unless already defined assume 8MHz system frequency
+// This definition is required to calibrate __delay_us() and __delay_ms()
+#define _XTAL_FREQ 8000000
+#endif
+
+//#define DELAY_SLEEP           // Sleep in long delays, the WDT wakes up
+
+// Delays shorter than DELAY_SLEEP_MIN [ms] spin.
+// Longer ones SLEEP in chunks of the WDT (1:512 of LFINTOSC, 16.5ms typical
+// but 10-27ms by the data sheet). A chunk counts as delay_wdt_tmr0, the
+// period measured by delay_calibrate() against the RTC and rounded down,
+// so a delay is never shorter than asked. They spin until it is measured.
+#define DELAY_SLEEP_MIN 16
+#define DELAY_WDTCON    0x08    // WDTPS 1:512, SWDTEN off
+#define DELAY_WDT_MIN   10000   // shortest period of the WDT [us]
+#define DELAY_WDT_MAX   27000   // longest period of the WDT [us]
+#define DELAY_TMR0_US   128     // count of Timer0 (Fosc/4, 1:256) [us]
+#define DELAY_TICK_US   32256   // period of the timer interrupt [us]
+#define DELAY_CAL_WDTCON 0x00  // WDTPS 1:32 of the calibration
+#define DELAY_CAL_COUNT 8       // RTC timer count of the calibration (125ms)
+
+#ifdef DELAY_SLEEP
+/**
+ * Counts up by the timer interrupt (also while sleeping in delay_ms())
+ */
+extern volatile unsigned char delay_tick;
+
+// Call this from the timer interrupt
+#define delay_proc_every_timer_interrupt() (delay_tick++)
+
+// Deadline after ms [ms], up to 4 seconds ("not before" of delay_passed())
+#define delay_deadline(ms) \
+    ((unsigned char)(delay_tick + ((ms) * 1000L + DELAY_TICK_US - 1) / DELAY_TICK_US + 1))
+// Whether the deadline was passed
+#define delay_passed(deadline) ((signed char)(delay_tick - (deadline)) >= 0)
+
+/**
+ * Period of the WDT in counts of Timer0, rounded down (0: not measured)
+ */
+extern unsigned char delay_wdt_tmr0;
+
+void delay_ms(unsigned short ms);
+char delay_calibrate(unsigned char int_pin);
+#else
+#define delay_ms(ms) __delay_ms(ms)
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// GPIO expander
+//  - PCF8574
+//  - i2c protocol
+
+#include "hal.h"
+#include "i2c.h"
+#include "gpio_pcf8574.h"
+
+#ifdef VALVE_ZONES
+
+static unsigned char gpio_shadow;   // port written last
+
+/**
+ * !@brief Initialize the port to GPIO_OFF
+ *
+ * Written even if the shadow matches, the expander keeps the port over a
+ * reset of the MCU.
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+int gpio_init(void)
+{
+    gpio_shadow = (unsigned char)~GPIO_OFF;
+    return gpio_write(GPIO_OFF);
+}
+
+/**
+ * !@brief Write the port if it changes
+ *
+ * The shadow is updated only on success, so a failed write is sent again
+ * by the next call.
+ * @param[in] dt Port P7-P0
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+int gpio_write(unsigned char dt)
+{
+    int ret;
+
+    if (dt == gpio_shadow) {
+        return 0;
+    }
+    ret = i2c_start(GPIO_ADDR, RW_0);
+    if (ret == 0) {
+        ret = i2c_send(dt);
+    }
+    ret |= i2c_stop();
+    if (ret == 0) {
+        gpio_shadow = dt;
+    }
+    return ret;
+}
+#endif
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+// GPIO expander
+//  - PCF8574
+//  - i2c protocol
+//  - The port is quasi-bidirectional: HI is a weak pull-up, so the loads
+//    (e.g. the relays of the valves) are driven by LO.
+//  - gpio_write() keeps a shadow of the port and sends a byte only when
+//    the port changes.
+//  - With VALVE_ZONES, main.c waters the zones one after another in a pump
+//    session of the alarm, the valve of zone n is on Pn-1.
+
+//#define VALVE_ZONES     4   // Zones (1-8) watered by the valves on the expander
+
+#ifndef _GPIO_PCF8574_H_
+#define _GPIO_PCF8574_H_
+
+#define GPIO_ADDR   0x20    // A2-A0 are LO (PCF8574A: 0x38)
+#define GPIO_OFF    0xff    // all HI, as after power on
+
+int gpio_init(void);
+int gpio_write(unsigned char dt);
+
+#endif
@@ -0,0 +1,43 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Hardware abstraction layer
+//  - PIC build (XC8)  : maps everything to <xc.h>.
+//  - Host build (gcc) : HAL_HOST is defined by host/Makefile and
+//                       SFRs, __delay_us/ms, SLEEP() and the interrupt entry
+//                       are mapped to the peripheral model in host/hal_host.c.
+// Sources include this header instead of <xc.h>.
+
+#ifndef _HAL_H_
+#define _HAL_H_
+
+#ifdef HAL_HOST
+#include "hal_host.h"
+#else
+#include <xc.h>
+
+// Called in every busy-wait loop. Nothing to do on the PIC.
+// On the host it lets the peripheral model run.
+#define HAL_POLL()
+#endif
+
+#endif
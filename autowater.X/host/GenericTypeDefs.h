@@ -0,0 +1,11 @@
+// Host replacement of <GenericTypeDefs.h> of the Microchip libraries.
+// Only the types used by the firmware.
+
+#ifndef _GENERIC_TYPE_DEFS_H_
+#define _GENERIC_TYPE_DEFS_H_
+
+typedef unsigned char   BYTE;   // 8-bit unsigned
+typedef unsigned short  WORD;   // 16-bit unsigned
+typedef unsigned int    DWORD;  // 32-bit unsigned
+
+#endif
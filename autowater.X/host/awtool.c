@@ -0,0 +1,186 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+// Tool of the EUSART telemetry (UART_TELEMETRY of uart.h)
+//  - Opens the serial port (9600bps 8N1, raw), wakes up the unit by
+//    UART_WAKE, sends a frame and prints the status returned.
+//  - Works with a USB serial adapter on the unit or with sim -p.
+//
+// Usage: awtool [-d device] status
+//        awtool [-d device] set HH:MM on|off SEC [now|YYYY-MM-DD hh:mm:ss]
+//          set the alarm, the pump time [sec] and optionally the clock
+
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "frame.h"
+
+#define REPLY_TIMEOUT   3       // [sec], setting the clock takes a second
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "usage: %s [-d device] status\n"
+            "       %s [-d device] set HH:MM on|off SEC [now|YYYY-MM-DD hh:mm:ss]\n",
+            name, name);
+    exit(2);
+}
+
+/**
+ * !@brief Open the serial port in raw 9600bps 8N1
+ */
+static int port_open(const char *dev)
+{
+    struct termios tio;
+    int fd = open(dev, O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || tcgetattr(fd, &tio) != 0) {
+        perror(dev);
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B9600);
+    cfsetospeed(&tio, B9600);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        perror(dev);
+        exit(1);
+    }
+    tcflush(fd, TCIFLUSH);      // old frames (e.g. the status at boot)
+    return fd;
+}
+
+/**
+ * !@brief Parse the time to set, tm of uart.h order
+ */
+static int parse_clock(int argc, char *argv[], unsigned char *tm)
+{
+    struct tm t;
+    time_t now;
+
+    memset(&t, 0, sizeof(t));
+    if (argc == 1 && strcmp(argv[0], "now") == 0) {
+        now = time(NULL);
+        localtime_r(&now, &t);
+    } else if (argc == 2 &&
+               sscanf(argv[0], "%d-%d-%d", &t.tm_year, &t.tm_mon, &t.tm_mday) == 3 &&
+               sscanf(argv[1], "%d:%d:%d", &t.tm_hour, &t.tm_min, &t.tm_sec) == 3) {
+        t.tm_year -= 1900;
+        t.tm_mon -= 1;
+        t.tm_isdst = -1;
+        mktime(&t);             // weekday
+    } else {
+        return -1;
+    }
+    tm[0] = t.tm_sec;
+    tm[1] = t.tm_min;
+    tm[2] = t.tm_hour;
+    tm[3] = t.tm_mday;
+    tm[4] = t.tm_wday;
+    tm[5] = t.tm_mon + 1;
+    tm[6] = t.tm_year % 100;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *dev = "/dev/ttyUSB0";
+    unsigned char payload[UART_PAYLOAD];
+    unsigned char out[FRAME_MAX];
+    unsigned char wake = UART_WAKE;
+    unsigned char type;
+    char text[160];
+    frame_t reply;
+    int len = 0;
+    int fd, n, i = 1;
+
+    if (argc > 2 && strcmp(argv[1], "-d") == 0) {
+        dev = argv[2];
+        i = 3;
+    }
+    if (i < argc && strcmp(argv[i], "status") == 0 && argc == i + 1) {
+        type = UART_QUERY;
+    } else if (i < argc && strcmp(argv[i], "set") == 0 && argc >= i + 4) {
+        int h, m, sec = atoi(argv[i + 3]);
+        if (sscanf(argv[i + 1], "%d:%d", &h, &m) != 2 || h < 0 || h > 23 ||
+            m < 0 || m > 59 || sec < 1 || sec > 99 ||
+            (strcmp(argv[i + 2], "on") != 0 && strcmp(argv[i + 2], "off") != 0)) {
+            usage(argv[0]);
+        }
+        type = UART_CONFIG;
+        payload[0] = (strcmp(argv[i + 2], "on") == 0);
+        payload[1] = m;
+        payload[2] = h;
+        payload[3] = sec;
+        len = UART_CONFIG_LEN;
+        if (argc > i + 4) {
+            if (parse_clock(argc - i - 4, &argv[i + 4], &payload[UART_CONFIG_LEN]) != 0) {
+                usage(argv[0]);
+            }
+            len = UART_CONFIG_TIME_LEN;
+        }
+    } else {
+        usage(argv[0]);
+    }
+
+    fd = port_open(dev);
+    n = frame_build(out, type, payload, len);
+    if (write(fd, &wake, 1) != 1) {
+        perror(dev);
+        return 1;
+    }
+    usleep(UART_WAKE_MS * 1000);
+    if (write(fd, out, n) != n) {
+        perror(dev);
+        return 1;
+    }
+
+    memset(&reply, 0, sizeof(reply));
+    for (;;) {
+        struct timeval tv = {REPLY_TIMEOUT, 0};
+        unsigned char c;
+        fd_set fds;
+
+        FD_ZERO(&fds);
+        FD_SET(fd, &fds);
+        if (select(fd + 1, &fds, NULL, NULL, &tv) <= 0) {
+            fprintf(stderr, "%s: no reply\n", dev);
+            return 1;
+        }
+        if (read(fd, &c, 1) != 1) {
+            continue;
+        }
+        if (frame_feed(&reply, c) == 1 && reply.type == UART_STATUS) {
+            break;
+        }
+    }
+    frame_string(&reply, text, sizeof(text));
+    printf("%s\n", text);
+    return 0;
+}
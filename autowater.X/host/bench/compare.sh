@@ -0,0 +1,50 @@
+#!/bin/sh
+#
+# Compare two benchmark results of 'make bench'
+#
+# Usage: bench/compare.sh old.json new.json [tolerance%]
+#   Prints every metric of every scenario with the change.
+#   Exit status is 1 when any metric grew more than tolerance (default 1%).
+#   'seconds' and 'naps' (traded for awake time) aren't checked.
+#   A metric or scenario only in new.json is shown as "new", not checked.
+#
+
+[ $# -ge 2 ] || { echo "usage: $0 old.json new.json [tolerance%]" >&2; exit 2; }
+
+awk -v tol="${3:-1}" '
+# {"scenario":"name","key":value,...} => vals[file, name, key]
+{
+    line = $0
+    gsub(/[{}"]/, "", line)
+    n = split(line, kv, ",")
+    split(kv[1], p, ":")
+    name = p[2]
+    for (i = 2; i <= n; i++) {
+        split(kv[i], p, ":")
+        vals[FILENAME == ARGV[1], name, p[1]] = p[2]
+        if (!((name, p[1]) in seen)) {
+            seen[name, p[1]] = 1
+            order[++count] = name SUBSEP p[1]
+        }
+    }
+}
+END {
+    bad = 0
+    for (i = 1; i <= count; i++) {
+        split(order[i], k, SUBSEP)
+        new = vals[0, k[1], k[2]]
+        if (!((1, k[1], k[2]) in vals)) {
+            printf "%-12s %-18s %14s %14s %9s\n", k[1], k[2], "-", new, "new"
+            continue
+        }
+        old = vals[1, k[1], k[2]]
+        diff = (old != 0) ? (new - old) * 100 / old : (new != 0 ? 100 : 0)
+        mark = ""
+        if (diff > tol && k[2] != "seconds" && k[2] != "naps") {
+            mark = "  <= regression"
+            bad = 1
+        }
+        printf "%-12s %-18s %14s %14s %+8.2f%%%s\n", k[1], k[2], old, new, diff, mark
+    }
+    exit bad
+}' "$1" "$2"
@@ -0,0 +1,56 @@
+#!/bin/sh
+#
+# Print the program words of the BCD/formatting kernels from the output of XC8
+#
+#  usage: funcsize.sh <funclist | .map> [function ...]
+#
+#  funclist: "_name: CODE, <addr> 0 <words>"
+#  .map:     "_name  <psect>  <addr>" and "__end_of_name  <psect>  <addr>"
+#
+
+[ $# -ge 1 ] || { echo "usage: $0 <funclist|map> [function ...]" >&2; exit 2; }
+file=$1
+shift
+[ $# -ge 1 ] || set -- bcd2bin bin2bcd set_ctime rtc_time_to_string ___wmul
+
+awk -v funcs="$*" '
+BEGIN {
+    n = split(funcs, list, " ")
+}
+# funclist
+/^_[A-Za-z0-9_]+: CODE,/ {
+    name = substr($1, 2, length($1) - 2)
+    words[name] = $NF
+}
+# map
+$1 ~ /^_/ && NF == 3 && $3 ~ /^[0-9A-F]+$/ {
+    if (substr($1, 1, 9) == "__end_of_") {
+        end[substr($1, 10)] = $3
+    } else {
+        start[substr($1, 2)] = $3
+    }
+}
+function hex(s,    i, v) {
+    v = 0
+    for (i = 1; i <= length(s); i++) {
+        v = v * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+    }
+    return v
+}
+END {
+    total = 0
+    for (i = 1; i <= n; i++) {
+        f = list[i]
+        sub(/^_/, "", f)
+        if (!(f in words) && (f in start) && (f in end)) {
+            words[f] = hex(end[f]) - hex(start[f])
+        }
+        if (f in words) {
+            printf "  %-20s %5d words\n", f, words[f]
+            total += words[f]
+        } else {
+            printf "  %-20s     - (not linked)\n", f
+        }
+    }
+    printf "  %-20s %5d words\n", "total", total
+}' "$file"
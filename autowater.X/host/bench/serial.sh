@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# Check the EUSART telemetry (UART_TELEMETRY) of a HEADLESS build
+#
+#  usage: serial.sh <builddir>
+#
+#  1. scenarios/serial.txt: the frames sent by the scenario get their replies
+#  2. sim -p: awtool reads and sets the unit over the pseudo terminal
+#
+
+[ $# -eq 1 ] || { echo "usage: $0 <builddir>" >&2; exit 2; }
+dir=$1
+fail=0
+
+check() {
+    if grep -q "$2" "$1"; then
+        echo "ok   $2"
+    else
+        echo "FAIL $2"
+        fail=1
+    fi
+}
+
+"$dir/sim" scenarios/serial.txt > "$dir/serial.log" || fail=1
+check "$dir/serial.log" "00:00:05.*status 2014-03-17 00:00:04 alarm on 07:00 10s pumps 0 status 2 bad 0"
+check "$dir/serial.log" "alarm on 00:02 5s pumps 0 status 2 bad 1"
+check "$dir/serial.log" "00:02:01.* status .* pumps 1 status 2 bad 2"
+check "$dir/serial.log" "uart: 76 bytes sent, 24 received, 0 lost"
+
+# 8 seconds on the wall clock
+printf '8s end\n' > "$dir/pty.txt"
+"$dir/sim" -p "$dir/pty.txt" > "$dir/pty.log" &
+sim=$!
+for i in 1 2 3 4 5 6 7 8 9 10; do
+    pty=$(sed -n 's/^pty //p' "$dir/pty.log")
+    [ -n "$pty" ] && break
+    sleep 0.1
+done
+sleep 3     # boot and the first sleep
+"$dir/awtool" -d "$pty" status > "$dir/awtool.log" 2>&1
+"$dir/awtool" -d "$pty" set 06:30 off 20 2020-01-02 03:04:05 >> "$dir/awtool.log" 2>&1
+wait $sim
+check "$dir/awtool.log" "status 2014-03-17 00:00:0[2-4] alarm on 07:00 10s pumps 0 status 2 bad 0"
+check "$dir/awtool.log" "status 2020-01-02 03:04:0[5-6] alarm off 06:30 20s pumps 0 status 1 bad 0"
+exit $fail
@@ -0,0 +1,383 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Cycle benchmark of the production hex
+//  - Runs the hex of XC8 on the instruction-set simulator (pic14e.c) with
+//    stubs of the RTC-8564NB (registers and the seconds, no alarm or timer)
+//    and the AQM0802A (DDRAM only) on the MSSP.
+//  - SW1 (RA4) is pressed for 200ms at every -p time (default 2000ms).
+//  - Counts the instruction cycles of every call of the functions found
+//    in the .map (default interrupt_func show_clock rtc_read_time display),
+//    with their callees but without the interrupts taken meanwhile, and
+//    of every loop() iteration: from a call of button_proc_every_main_loop
+//    to the next one from the same place, interrupts included.
+//  - With -j, prints one JSON line for bench/compare.sh.
+//  - With -v, prints the screen at the end.
+//
+// Usage: cycles [-j] [-v] [-t sec] [-p ms]... file.hex file.map [function...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "pic14e.h"
+
+#define SEC_TCY         (PIC_FOSC / 4)
+#define MS_TCY          (SEC_TCY / 1000)
+#define PRESS_MS        200
+#define SW1             (1<<4)      // RA4 of main.c
+#define MAX_FUNCS       16
+#define MAX_PRESSES     16
+#define LOOP_MARK       "button_proc_every_main_loop"
+
+typedef struct {
+    const char *name;
+    int addr;                       // -1: not in the map
+    unsigned long calls;
+    unsigned long long min, max, total;
+} prof_t;
+
+typedef struct {
+    int func;
+    unsigned char sp;               // stack level inside the function
+    unsigned long long start;
+    unsigned long long isr;         // isr_cycles at the start
+} frame_t;
+
+static pic14e_t pic;
+static prof_t funcs[MAX_FUNCS + 1]; // + loop iteration
+static int func_count;
+static frame_t frames[PIC_STACK + 2];
+static int depth;
+static int loop_addr = -1;
+static int loop_site = -1;          // return address of the first call
+static unsigned long long loop_start;
+static int in_isr;
+static unsigned char isr_sp;
+static unsigned long long isr_start;
+static unsigned long long isr_cycles;  // cycles of all interrupts so far
+
+// RTC-8564NB
+static pic_i2c_device_t rtc_dev;
+static unsigned char rtc_reg[16] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x17, 0x01, 0x03, 0x14,   // 2014-03-17 00:00:00
+    0x80, 0x80, 0x80, 0x80, 0x00, 0x00, 0x00
+};
+static unsigned char rtc_ptr;
+static int rtc_addr_phase;
+
+// AQM0802A
+static pic_i2c_device_t lcd_dev;
+static char ddram[0x80];
+static unsigned char lcd_ac;
+static int lcd_control;             // next byte is a control byte
+static int lcd_co, lcd_rs;
+
+static void record(prof_t *f, unsigned long long c)
+{
+    if (f->calls == 0 || c < f->min) {
+        f->min = c;
+    }
+    if (c > f->max) {
+        f->max = c;
+    }
+    f->total += c;
+    f->calls++;
+}
+
+static void on_call(pic14e_t *p, unsigned short target)
+{
+    if (target == loop_addr) {
+        int site = p->stack[p->sp - 1];
+        if (loop_site < 0) {
+            loop_site = site;
+        } else if (site == loop_site) {
+            record(&funcs[func_count], p->cycles - loop_start);
+        }
+        if (site == loop_site) {
+            loop_start = p->cycles;
+        }
+    }
+    for (int i = 0; i < func_count; i++) {
+        if (funcs[i].addr == target && depth < PIC_STACK + 2) {
+            frames[depth].func = i;
+            frames[depth].sp = p->sp;
+            frames[depth].start = p->cycles;
+            frames[depth].isr = isr_cycles;
+            depth++;
+        }
+    }
+}
+
+static void on_interrupt(pic14e_t *p)
+{
+    in_isr = 1;
+    isr_sp = p->sp;
+    isr_start = p->cycles - 3;      // with the latency
+    on_call(p, PIC_VECTOR);
+    if (depth > 0 && frames[depth - 1].sp == p->sp) {
+        frames[depth - 1].start = isr_start + 3;
+    }
+}
+
+static void on_return(pic14e_t *p)
+{
+    while (depth > 0 && frames[depth - 1].sp > p->sp) {
+        frame_t *fr = &frames[--depth];
+        record(&funcs[fr->func], p->cycles - fr->start - (isr_cycles - fr->isr));
+    }
+    if (in_isr && p->sp < isr_sp) {
+        in_isr = 0;
+        isr_cycles += p->cycles - isr_start;
+    }
+}
+
+static void rtc_start(pic_i2c_device_t *dev, unsigned char rw)
+{
+    rtc_addr_phase = (rw == 0);
+}
+
+static unsigned char rtc_write(pic_i2c_device_t *dev, unsigned char dt)
+{
+    if (rtc_addr_phase) {
+        rtc_addr_phase = 0;
+        rtc_ptr = dt & 0x0f;
+    } else {
+        rtc_reg[rtc_ptr] = dt;
+        rtc_ptr = (rtc_ptr + 1) & 0x0f;
+    }
+    return 0;
+}
+
+static unsigned char rtc_read(pic_i2c_device_t *dev)
+{
+    unsigned char dt = rtc_reg[rtc_ptr];
+
+    rtc_ptr = (rtc_ptr + 1) & 0x0f;
+    return dt;
+}
+
+/**
+ * !@brief Count a BCD register up, return 1 on the carry
+ */
+static int bcd_inc(unsigned char *r, unsigned char mask, unsigned char limit)
+{
+    unsigned char v = (*r & mask) + 1;
+
+    if ((v & 0x0f) == 10) {
+        v += 6;
+    }
+    *r = (v >= limit) ? 0 : v;
+    return v >= limit;
+}
+
+static void rtc_second(void)
+{
+    if (bcd_inc(&rtc_reg[2], 0x7f, 0x60) && bcd_inc(&rtc_reg[3], 0x7f, 0x60)) {
+        bcd_inc(&rtc_reg[4], 0x3f, 0x24);
+    }
+}
+
+static void lcd_start(pic_i2c_device_t *dev, unsigned char rw)
+{
+    lcd_control = 1;
+}
+
+static unsigned char lcd_write(pic_i2c_device_t *dev, unsigned char dt)
+{
+    if (lcd_control) {
+        lcd_co = dt & 0x80;
+        lcd_rs = dt & 0x40;
+        lcd_control = 0;
+        return 0;
+    }
+    if (lcd_rs) {
+        ddram[lcd_ac & 0x7f] = dt;
+        lcd_ac = (lcd_ac + 1) & 0x7f;
+    } else if (dt == 0x01) {
+        memset(ddram, ' ', sizeof(ddram));
+        lcd_ac = 0;
+    } else if (dt & 0x80) {
+        lcd_ac = dt & 0x7f;
+    }
+    lcd_control = (lcd_co != 0);
+    return 0;
+}
+
+/**
+ * !@brief Address of the function in the .map of XC8
+ *
+ * "_name  <psect>  <addr>" of a code psect (text*, intentry)
+ */
+static int map_addr(const char *path, const char *name)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256], sym[128], psect[64];
+    unsigned int addr;
+    int found = -1;
+
+    if (fp == NULL) {
+        perror(path);
+        exit(2);
+    }
+    while (found < 0 && fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%127s %63s %x", sym, psect, &addr) == 3 && sym[0] == '_' &&
+            strcmp(sym + 1, name) == 0 &&
+            (strstr(psect, "text") != NULL || strcmp(psect, "intentry") == 0)) {
+            found = (int)addr;
+        }
+    }
+    fclose(fp);
+    return found;
+}
+
+static void print_row(const prof_t *f)
+{
+    if (f->addr < 0) {
+        printf("%-28s %8s\n", f->name, "- (not in the map)");
+    } else if (f->calls == 0) {
+        printf("%-28s %8d\n", f->name, 0);
+    } else {
+        printf("%-28s %8lu %10llu %10llu %12.1f\n", f->name, f->calls, f->min, f->max,
+               (double)f->total / f->calls);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long long end, next, presses[MAX_PRESSES];
+    unsigned long long next_sec = SEC_TCY;
+    int press_count = 0, press_pos = 0, pressed = 0;
+    int json = 0, verbose = 0, opt, r;
+    double seconds = 4;
+    static const char *defaults[] = {"interrupt_func", "show_clock", "rtc_read_time", "display"};
+
+    while ((opt = getopt(argc, argv, "jvt:p:")) != -1) {
+        if (opt == 'j') {
+            json = 1;
+        } else if (opt == 'v') {
+            verbose = 1;
+        } else if (opt == 't') {
+            seconds = atof(optarg);
+        } else if (opt == 'p' && press_count < MAX_PRESSES) {
+            presses[press_count++] = strtoull(optarg, NULL, 10) * MS_TCY;
+        } else {
+            optind = argc + 1;
+            break;
+        }
+    }
+    if (optind + 2 > argc) {
+        fprintf(stderr, "usage: %s [-j] [-v] [-t sec] [-p ms]... file.hex file.map [function...]\n",
+                argv[0]);
+        return 2;
+    }
+    if (press_count == 0) {
+        presses[press_count++] = 2000 * MS_TCY;
+    }
+    for (int i = optind + 2; i < argc && func_count < MAX_FUNCS; i++) {
+        funcs[func_count++].name = argv[i];
+    }
+    for (int i = 0; func_count == 0 && i < 4; i++) {
+        funcs[i].name = defaults[i];
+        if (i == 3) {
+            func_count = 4;
+        }
+    }
+    for (int i = 0; i < func_count; i++) {
+        funcs[i].addr = map_addr(argv[optind + 1], funcs[i].name);
+    }
+    loop_addr = map_addr(argv[optind + 1], LOOP_MARK);
+    funcs[func_count].name = "loop iteration";
+    funcs[func_count].addr = loop_addr;
+
+    pic_reset(&pic);
+    if (pic_load_hex(&pic, argv[optind]) < 0) {
+        return 2;
+    }
+    pic.on_call = on_call;
+    pic.on_return = on_return;
+    pic.on_interrupt = on_interrupt;
+    rtc_dev.addr = 0x51;
+    rtc_dev.start = rtc_start;
+    rtc_dev.write = rtc_write;
+    rtc_dev.read = rtc_read;
+    pic_i2c_attach(&pic, &rtc_dev);
+    lcd_dev.addr = 0x3e;
+    lcd_dev.start = lcd_start;
+    lcd_dev.write = lcd_write;
+    pic_i2c_attach(&pic, &lcd_dev);
+    memset(ddram, ' ', sizeof(ddram));
+
+    // presses and seconds of the RTC until the end
+    end = (unsigned long long)(seconds * SEC_TCY);
+    while (pic.time < end) {
+        next = end;
+        if (next_sec < next) {
+            next = next_sec;
+        }
+        if (press_pos < press_count) {
+            unsigned long long edge = presses[press_pos] + (pressed ? PRESS_MS * MS_TCY : 0);
+            if (edge < next) {
+                next = edge;
+            }
+        }
+        r = pic_run(&pic, next);
+        if (r < 0) {
+            return 1;
+        }
+        if (pic.time >= next_sec) {
+            rtc_second();
+            next_sec += SEC_TCY;
+        }
+        if (press_pos < press_count &&
+            pic.time >= presses[press_pos] + (pressed ? PRESS_MS * MS_TCY : 0)) {
+            pic_set_pins(&pic, SW1, pressed);
+            if (pressed) {
+                press_pos++;
+            }
+            pressed = !pressed;
+        }
+    }
+
+    if (json) {
+        printf("{\"scenario\":\"cycles\"");
+        for (int i = 0; i <= func_count; i++) {
+            const char *key = (i == func_count) ? "loop" : funcs[i].name;
+            if (funcs[i].calls) {
+                printf(",\"%s_max\":%llu,\"%s_avg\":%.1f", key, funcs[i].max, key,
+                       (double)funcs[i].total / funcs[i].calls);
+            }
+        }
+        printf(",\"executed\":%llu}\n", pic.cycles);
+        return 0;
+    }
+    printf("%s: %.3f s, %llu cycles executed (Tcy %luns)\n", argv[optind], seconds,
+           pic.cycles, PIC_TCY_NS);
+    printf("%-28s %8s %10s %10s %12s\n", "[cycles]", "calls", "min", "max", "avg");
+    for (int i = 0; i <= func_count; i++) {
+        print_row(&funcs[i]);
+    }
+    if (verbose) {
+        printf("screen [%.8s] [%.8s]\n", ddram, ddram + 0x40);
+    }
+    return 0;
+}
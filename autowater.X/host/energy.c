@@ -0,0 +1,229 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Energy-per-day estimator
+//  - Reads the state timeline of the simulator (sim -t) and the supply
+//    currents (energy.conf), and prints the charge per day by source.
+//  - Timeline line:
+//      <start[s]> <duration[s]> active|sleep <i2c busy[s]> <lcd on[s]> <relay on[s]>
+//      [<pull-up LO [pin*s]> <floating [pin*s]> [<sensor on [s]>]]
+//
+// Usage: energy [-c energy.conf] timeline.txt
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DAY_SEC     86400.0
+#define MAX_DAYS    400
+
+// sources
+enum {
+    SRC_MCU_ACTIVE,
+    SRC_MCU_SLEEP,
+    SRC_I2C,
+    SRC_LCD,
+    SRC_RTC,
+    SRC_RELAY,
+    SRC_PINS,
+    SRC_SENSOR,
+    SRC_COUNT
+};
+
+static const char *src_names[SRC_COUNT] = {
+    "mcu_active", "mcu_sleep", "i2c", "lcd", "rtc", "relay", "pins", "sensor"
+};
+
+typedef struct {
+    double mcu_active;
+    double mcu_sleep;
+    double i2c_active;
+    double lcd_on;
+    double lcd_off;
+    double rtc;
+    double relay_on;
+    double pullup_lo;
+    double pin_float;
+    double sensor_on;
+    double battery_mah;
+} energy_conf_t;
+
+static energy_conf_t conf = {1.0, 0.02, 0.33, 0.25, 0.001, 0.0004, 40, 0.1, 0.001, 5, 0};
+
+/**
+ * !@brief Load "key = value" lines
+ */
+static int load_conf(const char *path)
+{
+    static const struct {
+        const char *key;
+        double *val;
+    } keys[] = {
+        {"mcu_active", &conf.mcu_active},
+        {"mcu_sleep", &conf.mcu_sleep},
+        {"i2c_active", &conf.i2c_active},
+        {"lcd_on", &conf.lcd_on},
+        {"lcd_off", &conf.lcd_off},
+        {"rtc", &conf.rtc},
+        {"relay_on", &conf.relay_on},
+        {"pullup_lo", &conf.pullup_lo},
+        {"pin_float", &conf.pin_float},
+        {"sensor_on", &conf.sensor_on},
+        {"battery_mah", &conf.battery_mah},
+    };
+    FILE *fp = fopen(path, "r");
+    char line[256], key[64];
+    double val;
+    int lineno = 0;
+
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *hash = strchr(line, '#');
+        size_t i;
+
+        lineno++;
+        if (hash) {
+            *hash = '\0';
+        }
+        if (sscanf(line, " %63[a-z0-9_] = %lf", key, &val) != 2) {
+            if (strspn(line, " \t\r\n") != strlen(line)) {
+                fprintf(stderr, "%s:%d: syntax error\n", path, lineno);
+                return -1;
+            }
+            continue;
+        }
+        for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+            if (strcmp(keys[i].key, key) == 0) {
+                *keys[i].val = val;
+                break;
+            }
+        }
+        if (i == sizeof(keys) / sizeof(keys[0])) {
+            fprintf(stderr, "%s:%d: unknown key '%s'\n", path, lineno, key);
+            return -1;
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static double day_mas[MAX_DAYS][SRC_COUNT];   // charge [mA*s]
+    double total[SRC_COUNT] = {0};
+    double seconds = 0, sum;
+    const char *path = NULL;
+    char line[256], state[16];
+    double start, dur, i2c, lcd, relay, pullup, floating, sensor;
+    int ndays = 0;
+    FILE *fp;
+
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            if (load_conf(argv[++i]) != 0) {
+                return 1;
+            }
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [-c energy.conf] timeline.txt\n", argv[0]);
+        return 2;
+    }
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        perror(path);
+        return 1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        double *d;
+        int day;
+
+        pullup = floating = sensor = 0;     // not in the old timeline
+        if (sscanf(line, "%lf %lf %15s %lf %lf %lf %lf %lf %lf", &start, &dur, state, &i2c, &lcd,
+                   &relay, &pullup, &floating, &sensor) < 6) {
+            continue;
+        }
+        day = (int)(start / DAY_SEC);
+        if (day >= MAX_DAYS) {
+            day = MAX_DAYS - 1;
+        }
+        if (day + 1 > ndays) {
+            ndays = day + 1;
+        }
+        d = day_mas[day];
+        if (strcmp(state, "sleep") == 0) {
+            d[SRC_MCU_SLEEP] += conf.mcu_sleep * dur;
+        } else {
+            d[SRC_MCU_ACTIVE] += conf.mcu_active * dur;
+        }
+        d[SRC_I2C] += conf.i2c_active * i2c;
+        d[SRC_LCD] += conf.lcd_on * lcd + conf.lcd_off * (dur - lcd);
+        d[SRC_RTC] += conf.rtc * dur;
+        d[SRC_RELAY] += conf.relay_on * relay;
+        d[SRC_PINS] += conf.pullup_lo * pullup + conf.pin_float * floating;
+        d[SRC_SENSOR] += conf.sensor_on * sensor;
+        seconds += dur;
+    }
+    fclose(fp);
+    if (seconds <= 0) {
+        fprintf(stderr, "%s: empty timeline\n", path);
+        return 1;
+    }
+
+    printf("%-6s", "day");
+    for (int s=0; s<SRC_COUNT; s++) {
+        printf(" %10s", src_names[s]);
+    }
+    printf(" %10s\n", "mAh");
+    for (int day=0; day<ndays; day++) {
+        sum = 0;
+        printf("%-6d", day);
+        for (int s=0; s<SRC_COUNT; s++) {
+            printf(" %10.4f", day_mas[day][s] / 3600);
+            sum += day_mas[day][s];
+            total[s] += day_mas[day][s];
+        }
+        printf(" %10.4f\n", sum / 3600);
+    }
+
+    // average per day
+    sum = 0;
+    for (int s=0; s<SRC_COUNT; s++) {
+        sum += total[s];
+    }
+    printf("\nper day (average of %.2f days)\n", seconds / DAY_SEC);
+    for (int s=0; s<SRC_COUNT; s++) {
+        printf("  %-12s %10.4f mAh %6.1f%%\n", src_names[s],
+               total[s] / 3600 * DAY_SEC / seconds, total[s] * 100 / sum);
+    }
+    printf("  %-12s %10.4f mAh\n", "total", sum / 3600 * DAY_SEC / seconds);
+    if (conf.battery_mah > 0) {
+        printf("  %-12s %10.1f days (%.0f mAh)\n", "supply",
+               conf.battery_mah / (sum / 3600 * DAY_SEC / seconds), conf.battery_mah);
+    }
+    return 0;
+}
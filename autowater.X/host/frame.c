@@ -0,0 +1,98 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+// Frames of the EUSART telemetry (uart.h) on the host side
+
+#include <stdio.h>
+#include <string.h>
+#include "frame.h"
+
+/**
+ * !@brief Feed a received byte
+ *
+ * @return 1 when a frame completed, -1 when it was broken, 0 otherwise
+ */
+int frame_feed(frame_t *f, unsigned char c)
+{
+    if (f->pos == 0) {
+        if (c == UART_SOF) {
+            f->sum = 0;
+            f->pos = 1;
+        }
+        return 0;
+    }
+    f->sum += c;
+    if (f->pos == 1) {
+        f->type = c;
+    } else if (f->pos == 2) {
+        f->len = c;
+    } else if (f->pos - 3 < f->len) {
+        f->data[f->pos - 3] = c;
+    } else {
+        f->pos = 0;
+        return (f->sum == 0) ? 1 : -1;
+    }
+    f->pos++;
+    return 0;
+}
+
+/**
+ * !@brief Make a frame
+ *
+ * @param[out] out Frame, FRAME_MAX bytes for the payloads of uart.h
+ * @return Length of the frame
+ */
+int frame_build(unsigned char *out, unsigned char type, const unsigned char *data, int len)
+{
+    unsigned char sum = type + len;
+
+    out[0] = UART_SOF;
+    out[1] = type;
+    out[2] = len;
+    for (int i=0; i<len; i++) {
+        out[3 + i] = data[i];
+        sum += data[i];
+    }
+    out[3 + len] = -sum;
+    return len + 4;
+}
+
+/**
+ * !@brief Describe a frame, UART_STATUS decoded
+ *
+ * e.g. "status 2014-03-17 06:59:58 alarm on 07:00 10s pumps 1 status 2 bad 0"
+ */
+void frame_string(const frame_t *f, char *buf, size_t size)
+{
+    const unsigned char *d = f->data;
+    int n;
+
+    if (f->type == UART_STATUS && f->len == UART_STATUS_LEN) {
+        snprintf(buf, size, "status 20%02u-%02u-%02u %02u:%02u:%02u alarm %s %02u:%02u %us "
+                 "pumps %u status %u bad %u", d[6], d[5], d[3], d[2], d[1], d[0],
+                 d[7] ? "on" : "off", d[9], d[8], d[10], d[11] | d[12] << 8, d[13], d[14]);
+        return;
+    }
+    n = snprintf(buf, size, "%c", f->type);
+    for (int i=0; i<f->len && n < (int)size; i++) {
+        n += snprintf(buf + n, size - n, " %02x", d[i]);
+    }
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+// Frames of the EUSART telemetry (uart.h) on the host side
+//  - Shared by the simulator and awtool.
+
+#ifndef _FRAME_H_
+#define _FRAME_H_
+
+#include <stddef.h>
+#include "uart.h"
+
+#define FRAME_MAX       (UART_PAYLOAD + 4)  // SOF, type, length, payload, checksum
+
+/**
+ * Receiver of frames
+ */
+typedef struct {
+    int pos;                        // 0:wait SOF 1:type 2:length 3-:payload
+    unsigned char type;
+    unsigned char len;
+    unsigned char sum;
+    unsigned char data[256];
+} frame_t;
+
+int  frame_feed(frame_t *f, unsigned char c);
+int  frame_build(unsigned char *out, unsigned char type, const unsigned char *data, int len);
+void frame_string(const frame_t *f, char *buf, size_t size);
+
+#endif
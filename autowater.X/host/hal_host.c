@@ -0,0 +1,848 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Host implementation of the hardware abstraction layer
+//  - Virtual clock advanced by __delay_us/ms, HAL_POLL() and SLEEP().
+//  - Peripheral model of PIC12F1822: Timer0, Timer1, Interrupt-on-Change, the WDT
+//    waking up from SLEEP, MSSP in i2c master mode with the bus timing
+//    of SSP1ADD, the asynchronous EUSART with the baud rate of SPBRG, the
+//    ADC with the conversion time of ADCS, FVR and the data EEPROM.
+//  - Interrupts are dispatched to interrupt_func() of main.c.
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <string.h>
+#include "hal_host.h"
+
+// MSSP operations
+enum {
+    MSSP_IDLE,
+    MSSP_START,
+    MSSP_RSTART,
+    MSSP_STOP,
+    MSSP_TX,
+    MSSP_RX,
+    MSSP_ACK
+};
+
+volatile hal_sfr_t hal_sfr[HAL_SFR_COUNT];
+volatile unsigned short hal_ssp1buf;
+volatile unsigned short hal_txreg;
+unsigned long long hal_time_ns;
+unsigned long long hal_time_limit_ns = HAL_NEVER;
+long hal_osc_ppm;
+long hal_lfosc_ppm;
+hal_stats_t hal_stats;
+void (*hal_watch)(void);
+void (*hal_uart_out)(unsigned char dt);
+unsigned short (*hal_adc_in)(unsigned char ch);
+
+extern void interrupt_func(void) __attribute__((weak));
+
+static jmp_buf hal_exit;
+static unsigned char hal_pins;          // level of input pins
+static unsigned char hal_sleeping;
+static unsigned char hal_in_isr;
+static unsigned long long t0_residual;  // ns toward next Timer0 tick
+static unsigned long long t1_residual;  // ns toward next Timer1 tick
+static unsigned char mssp_op;
+static unsigned long long mssp_done;    // time when mssp_op completes
+static unsigned char mssp_addr_phase;   // next byte is slave address
+static hal_i2c_device_t *mssp_dev;      // addressed slave
+static hal_i2c_device_t *i2c_devices;
+static hal_model_t *models;
+static unsigned char uart_tsr;          // byte being sent
+static unsigned long long uart_tx_done; // time when uart_tsr is sent
+static unsigned char uart_fifo[2];      // receive FIFO of RCREG
+static int uart_fifo_n;
+static unsigned char uart_line[256];    // bytes on RX from outside
+static int uart_line_head;
+static int uart_line_n;
+static unsigned long long uart_rx_at;   // next edge of RX: start or stop bit
+static unsigned char uart_rx_in_byte;   // uart_rx_at is the stop bit
+static unsigned char uart_rx_wake;      // the current byte woke up (lost)
+static unsigned long long adc_done;    // time when the conversion completes
+static unsigned char hal_eeprom[HAL_EEPROM_SIZE];
+static unsigned long long eeprom_ready; // time when a write completes
+
+#define UART_LINE_BIT_NS  104167ULL     // the other end sends at 9600bps
+
+extern const unsigned char hal_eeprom_data[8] __attribute__((weak));
+
+static void hal_advance(unsigned long long end);
+
+/**
+ * !@brief Reset SFRs to the power-on values
+ */
+void hal_reset(void)
+{
+    for (int i=0; i<HAL_SFR_COUNT; i++) {
+        hal_sfr[i].val = 0;
+    }
+    TRISA = 0x3f;
+    ANSELA = 0x17;
+    WPUA = 0x3f;
+    OPTION_REG = 0xff;
+    OSCCON = 0x38;
+    WDTCON = 0x16;
+    STATUS = 0x18;
+    TXSTA = 0x02;
+    BAUDCON = 0x40;
+    hal_ssp1buf = 0x100;
+    hal_txreg = 0x100;
+    hal_pins = 0x3f;
+    PORTA = hal_pins;
+    hal_time_ns = 0;
+    hal_sleeping = 0;
+    hal_in_isr = 0;
+    t0_residual = 0;
+    t1_residual = 0;
+    hal_osc_ppm = 0;
+    hal_lfosc_ppm = 0;
+    mssp_op = MSSP_IDLE;
+    mssp_dev = NULL;
+    i2c_devices = NULL;
+    models = NULL;
+    hal_watch = NULL;
+    hal_uart_out = NULL;
+    hal_adc_in = NULL;
+    adc_done = HAL_NEVER;
+    uart_tx_done = HAL_NEVER;
+    uart_fifo_n = 0;
+    uart_line_n = 0;
+    uart_rx_at = HAL_NEVER;
+    uart_rx_in_byte = 0;
+    for (int i=0; i<HAL_EEPROM_SIZE; i++) {
+        hal_eeprom[i] = (hal_eeprom_data != NULL && i < 8) ? hal_eeprom_data[i] : 0xff;
+    }
+    eeprom_ready = 0;
+    memset(&hal_stats, 0, sizeof(hal_stats));
+}
+
+/**
+ * !@brief Attach i2c slave model
+ */
+void hal_i2c_attach(hal_i2c_device_t *dev)
+{
+    dev->next = i2c_devices;
+    i2c_devices = dev;
+}
+
+/**
+ * !@brief Attach timed model
+ */
+void hal_model_attach(hal_model_t *m)
+{
+    m->next = models;
+    models = m;
+}
+
+/**
+ * !@brief Read EEPROM
+ */
+unsigned char eeprom_read(unsigned char addr)
+{
+    return hal_eeprom[addr];
+}
+
+/**
+ * !@brief Write EEPROM
+ *
+ * Like eeprom_write() of XC8, waits for the previous write and returns
+ * while the new one is in progress.
+ */
+void eeprom_write(unsigned char addr, unsigned char value)
+{
+    if (eeprom_ready > hal_time_ns) {
+        hal_advance(eeprom_ready);      // not on the MCU clock
+    }
+    hal_eeprom[addr] = value;
+    eeprom_ready = hal_time_ns + HAL_EEPROM_WRITE_NS;
+}
+
+/**
+ * !@brief Drive input pins from outside
+ *
+ * Set IOCAF and IOCIF by the edge and IOCAP/IOCAN.
+ * @param[in] mask Pins of PORTA
+ * @param[in] level 0:LO others:HI
+ */
+void hal_set_pin(unsigned char mask, unsigned char level)
+{
+    unsigned char old = hal_pins;
+    unsigned char edge;
+
+    hal_pins = level ? (hal_pins | mask) : (hal_pins & ~mask);
+    edge = (~old & hal_pins & IOCAP) | (old & ~hal_pins & IOCAN);
+    IOCAF = IOCAF | (edge & TRISA);
+}
+
+/**
+ * !@brief Pins whose weak pull-up is held LO from outside
+ *
+ * Each of them draws the pull-up current.
+ */
+unsigned char hal_pullup_lo(void)
+{
+    if (OPTION_REG & 0x80) {            // nWPUEN: all pull-ups off
+        return 0;
+    }
+    return WPUA & TRISA & ~hal_pins & 0x3f;
+}
+
+/**
+ * !@brief Digital inputs left floating
+ *
+ * The board has no pull-ups of its own, so a released switch, /INT of the
+ * RTC or an I2C line floats without the weak pull-up.
+ */
+unsigned char hal_floating(void)
+{
+    unsigned char wpu = (OPTION_REG & 0x80) ? 0 : WPUA;
+
+    return TRISA & ~ANSELA & ~wpu & hal_pins & 0x3f;
+}
+
+/**
+ * !@brief Whether any enabled interrupt is pending
+ */
+static int hal_interrupt_pending(void)
+{
+    return (TMR0IE && TMR0IF) || (IOCIE && IOCIF) ||
+           (PEIE && ((TMR1IE && TMR1IF) || (SSP1IE && SSP1IF) || (BCL1IE && BCL1IF) ||
+                     (TXIE && TXIF) || (RCIE && RCIF)));
+}
+
+/**
+ * !@brief Whether an interrupt wakes up from SLEEP (GIE doesn't matter)
+ */
+static int hal_wake_pending(void)
+{
+    return (IOCIE && IOCIF) || (PEIE && RCIE && RCIF) || (TMR0IE && TMR0IF);
+}
+
+/**
+ * !@brief Update the state that the hardware maintains itself
+ */
+static void hal_update(void)
+{
+    PORTA = (PORTA & ~TRISA) | (hal_pins & TRISA);
+    IOCIF = (IOCAF != 0);
+    TXIF = TXSTAbits.TXEN && (hal_txreg & 0x100);
+    RCIF = (uart_fifo_n != 0);
+    FVRCONbits.FVRRDY = FVRCONbits.FVREN;
+    if (hal_watch) {
+        hal_watch();
+    }
+}
+
+/**
+ * !@brief Dispatch the interrupt like RETFIE does
+ */
+static void hal_interrupt(void)
+{
+    // Stop after some rounds when the handler doesn't clear the flag.
+    for (int n=0; n<8; n++) {
+        hal_update();
+        if (hal_in_isr || !GIE || !hal_interrupt_pending() || !interrupt_func) {
+            break;
+        }
+        GIE = 0;
+        hal_in_isr = 1;
+        hal_stats.isr_count++;
+        interrupt_func();
+        hal_in_isr = 0;
+        GIE = 1;
+    }
+}
+
+/**
+ * !@brief Error of INTOSC with the trim of OSCTUNE [ppm]
+ */
+long hal_osc_error(void)
+{
+    long tune = (OSCTUNE & 0x20) ? (long)(OSCTUNE & 0x3f) - 64 : (OSCTUNE & 0x3f);
+
+    return hal_osc_ppm + tune * HAL_OSCTUNE_PPM;
+}
+
+/**
+ * !@brief Real time of a span counted by the MCU clock
+ *
+ * @param[in] ns Time at exactly 8MHz
+ */
+static unsigned long long osc_ns(unsigned long long ns)
+{
+    return ns * 1000000ULL / (1000000LL + hal_osc_error());
+}
+
+/**
+ * !@brief i2c bit period from SSP1ADD
+ */
+static unsigned long long mssp_bit_ns(void)
+{
+    return osc_ns((SSP1ADD + 1ULL) * 4ULL * (1000000000ULL / HAL_FOSC));
+}
+
+/**
+ * !@brief Start MSSP operation requested by the firmware
+ */
+static void mssp_begin(void)
+{
+    unsigned long long bits = 1;
+
+    if (!SSP1CON1bits.SSPEN) {
+        mssp_op = MSSP_IDLE;
+        hal_ssp1buf |= 0x100;
+        return;
+    }
+    if (mssp_op != MSSP_IDLE) {
+        return;
+    }
+    if (SSP1CON2bits.SEN) {
+        mssp_op = MSSP_START;
+    } else if (SSP1CON2bits.RSEN) {
+        mssp_op = MSSP_RSTART;
+    } else if (SSP1CON2bits.PEN) {
+        mssp_op = MSSP_STOP;
+    } else if (SSP1CON2bits.RCEN) {
+        mssp_op = MSSP_RX;
+        bits = 8;
+    } else if (SSP1CON2bits.ACKEN) {
+        mssp_op = MSSP_ACK;
+    } else if (hal_ssp1buf < 0x100) {
+        mssp_op = MSSP_TX;
+        bits = 9;
+        SSP1STATbits.R_nW = 1;
+        SSP1STATbits.BF = 1;
+    } else {
+        return;
+    }
+    mssp_done = hal_time_ns + bits * mssp_bit_ns();
+    hal_stats.i2c_busy_ns += bits * mssp_bit_ns();
+    if (bits == 1) {
+        hal_stats.i2c_transactions += (mssp_op == MSSP_START);
+    } else {
+        hal_stats.i2c_bytes++;
+    }
+}
+
+/**
+ * !@brief Complete MSSP operation and raise SSP1IF
+ */
+static void mssp_complete(void)
+{
+    unsigned char dt;
+
+    switch (mssp_op) {
+    case MSSP_START:
+    case MSSP_RSTART:
+        SSP1CON2bits.SEN = 0;
+        SSP1CON2bits.RSEN = 0;
+        mssp_addr_phase = 1;
+        break;
+    case MSSP_STOP:
+        SSP1CON2bits.PEN = 0;
+        if (mssp_dev && mssp_dev->stop) {
+            mssp_dev->stop(mssp_dev);
+        }
+        mssp_dev = NULL;
+        break;
+    case MSSP_TX:
+        dt = (unsigned char)hal_ssp1buf;
+        hal_ssp1buf |= 0x100;
+        SSP1STATbits.R_nW = 0;
+        SSP1STATbits.BF = 0;
+        if (mssp_addr_phase) {
+            mssp_addr_phase = 0;
+            for (mssp_dev = i2c_devices; mssp_dev; mssp_dev = mssp_dev->next) {
+                if (mssp_dev->addr == (dt >> 1)) {
+                    break;
+                }
+            }
+            if (mssp_dev && mssp_dev->start) {
+                mssp_dev->start(mssp_dev, dt & 1);
+            }
+            SSP1CON2bits.ACKSTAT = (mssp_dev == NULL);
+        } else if (mssp_dev && mssp_dev->write) {
+            SSP1CON2bits.ACKSTAT = mssp_dev->write(mssp_dev, dt);
+        } else {
+            SSP1CON2bits.ACKSTAT = 1;
+        }
+        break;
+    case MSSP_RX:
+        SSP1CON2bits.RCEN = 0;
+        dt = (mssp_dev && mssp_dev->read) ? mssp_dev->read(mssp_dev) : 0xff;
+        hal_ssp1buf = 0x100 | dt;   // BF is cleared as if the firmware read it
+        break;
+    case MSSP_ACK:
+        SSP1CON2bits.ACKEN = 0;
+        SSP1STATbits.BF = 0;
+        break;
+    }
+    mssp_op = MSSP_IDLE;
+    SSP1IF = 1;
+}
+
+/**
+ * !@brief Bit period of the EUSART from SPBRG, BRG16 and BRGH
+ */
+static unsigned long long uart_bit_ns(void)
+{
+    unsigned long long n = BAUDCONbits.BRG16 ? (SPBRGH << 8 | SPBRGL) : SPBRGL;
+    unsigned long long div = 64 >> (2 * (BAUDCONbits.BRG16 + TXSTAbits.BRGH));
+
+    return osc_ns(div * (n + 1) * (1000000000ULL / HAL_FOSC));
+}
+
+/**
+ * !@brief Move TXREG to the shift register when it is empty
+ */
+static void uart_begin(void)
+{
+    if (uart_tx_done != HAL_NEVER || (hal_txreg & 0x100) ||
+        !RCSTAbits.SPEN || !TXSTAbits.TXEN) {
+        return;
+    }
+    uart_tsr = (unsigned char)hal_txreg;
+    hal_txreg |= 0x100;
+    uart_tx_done = hal_time_ns + 10 * uart_bit_ns();   // start, 8 data, stop
+    TXSTAbits.TRMT = 0;
+}
+
+/**
+ * !@brief The stop bit was sent
+ */
+static void uart_complete(void)
+{
+    uart_tx_done = HAL_NEVER;
+    TXSTAbits.TRMT = 1;
+    hal_stats.uart_tx_bytes++;
+    if (hal_uart_out) {
+        hal_uart_out(uart_tsr);
+    }
+    uart_begin();
+}
+
+/**
+ * !@brief Put a byte to the receive FIFO
+ *
+ * OERR is cleared by the next read, as the firmware clears it at once
+ * (toggling CREN isn't visible to the model).
+ */
+static void uart_fifo_put(unsigned char dt)
+{
+    if (uart_fifo_n == 2) {
+        RCSTAbits.OERR = 1;
+        hal_stats.uart_overruns++;
+        return;
+    }
+    uart_fifo[uart_fifo_n++] = dt;
+}
+
+/**
+ * !@brief Read RCREG
+ */
+unsigned char hal_uart_read(void)
+{
+    unsigned char dt = uart_fifo[0];
+
+    if (uart_fifo_n == 0) {
+        return 0;
+    }
+    uart_fifo[0] = uart_fifo[1];
+    uart_fifo_n--;
+    RCIF = (uart_fifo_n != 0);
+    RCSTAbits.OERR = 0;
+    return dt;
+}
+
+/**
+ * !@brief Send a byte to RX from outside (8N1, 9600bps)
+ *
+ * Bytes are queued and sent back to back.
+ */
+void hal_uart_rx(unsigned char dt)
+{
+    if (uart_line_n == sizeof(uart_line)) {
+        hal_stats.uart_overruns++;
+        return;
+    }
+    uart_line[(uart_line_head + uart_line_n++) % sizeof(uart_line)] = dt;
+    if (uart_rx_at == HAL_NEVER) {
+        uart_rx_at = hal_time_ns;
+        uart_rx_in_byte = 0;
+    }
+}
+
+/**
+ * !@brief Edge of RX: the start bit or the stop bit of the byte on the line
+ *
+ * With WUE the start bit sets RCIF (RCREG reads 0) and wakes up, the byte
+ * itself is lost. WUE is cleared at the end of it. The receiver doesn't
+ * run in SLEEP.
+ */
+static void uart_rx_edge(void)
+{
+    unsigned char dt;
+
+    if (!uart_rx_in_byte) {
+        uart_rx_in_byte = 1;
+        uart_rx_wake = RCSTAbits.SPEN && BAUDCONbits.WUE;
+        if (uart_rx_wake) {
+            uart_fifo_put(0);
+        }
+        uart_rx_at += 10 * UART_LINE_BIT_NS;
+        return;
+    }
+    dt = uart_line[uart_line_head];
+    uart_line_head = (uart_line_head + 1) % sizeof(uart_line);
+    uart_line_n--;
+    if (uart_rx_wake) {
+        BAUDCONbits.WUE = 0;
+    } else if (RCSTAbits.SPEN && RCSTAbits.CREN && !hal_sleeping) {
+        hal_stats.uart_rx_bytes++;
+        uart_fifo_put(dt);
+    } else {
+        hal_stats.uart_overruns++;
+    }
+    uart_rx_in_byte = 0;
+    if (uart_line_n == 0) {
+        uart_rx_at = HAL_NEVER;
+    }
+}
+
+/**
+ * !@brief Conversion time of the ADC (11.5 TAD) from ADCS
+ */
+static unsigned long long adc_conversion_ns(void)
+{
+    static const unsigned char div[8] = {2, 8, 32, 0, 4, 16, 64, 0};
+    unsigned long long tad = div[ADCON1bits.ADCS] * (1000000000ULL / HAL_FOSC);
+
+    if (tad == 0) {
+        return 1600 * 23 / 2;           // FRC (typ. 1.6us)
+    }
+    return osc_ns(tad * 23 / 2);
+}
+
+/**
+ * !@brief Start the conversion set by GO/nDONE
+ */
+static void adc_begin(void)
+{
+    if (adc_done != HAL_NEVER || !ADCON0bits.GO_nDONE) {
+        return;
+    }
+    if (!ADCON0bits.ADON) {
+        ADCON0bits.GO_nDONE = 0;
+        return;
+    }
+    adc_done = hal_time_ns + adc_conversion_ns();
+}
+
+/**
+ * !@brief Complete the conversion, the result of hal_adc_in()
+ */
+static void adc_complete(void)
+{
+    unsigned short v = hal_adc_in ? hal_adc_in(ADCON0bits.CHS) & 0x3ff : 0;
+
+    adc_done = HAL_NEVER;
+    hal_stats.adc_conversions++;
+    if (ADCON1bits.ADFM) {
+        ADRESH = v >> 8;
+        ADRESL = v & 0xff;
+    } else {
+        ADRESH = v >> 2;
+        ADRESL = (v & 3) << 6;
+    }
+    ADCON0bits.GO_nDONE = 0;
+    ADIF = 1;
+}
+
+/**
+ * !@brief Time of next Timer0 overflow
+ */
+static unsigned long long timer0_tick_ns(void)
+{
+    if (OPTION_REG & 0x08) {            // PSA: prescaler not assigned
+        return osc_ns(HAL_TCY_NS);
+    }
+    return osc_ns(HAL_TCY_NS << ((OPTION_REG & 0x07) + 1));
+}
+
+static int timer0_running(void)
+{
+    return !hal_sleeping && !(OPTION_REG & 0x20);   // TMR0CS: Fosc/4
+}
+
+static unsigned long long timer0_next(void)
+{
+    if (!timer0_running()) {
+        return HAL_NEVER;
+    }
+    return hal_time_ns + (256 - TMR0) * timer0_tick_ns() - t0_residual;
+}
+
+static void timer0_elapse(unsigned long long ns)
+{
+    unsigned long long tick = timer0_tick_ns();
+    unsigned long long ticks;
+
+    if (!timer0_running()) {
+        return;
+    }
+    t0_residual += ns;
+    ticks = t0_residual / tick;
+    t0_residual %= tick;
+    if (TMR0 + ticks >= 256) {
+        TMR0IF = 1;
+    }
+    TMR0 = (unsigned char)(TMR0 + ticks);
+}
+
+/**
+ * !@brief Time of next Timer1 overflow (only Fosc/4 is modelled)
+ */
+static unsigned long long timer1_tick_ns(void)
+{
+    return osc_ns(HAL_TCY_NS << T1CONbits.T1CKPS);
+}
+
+static int timer1_running(void)
+{
+    return !hal_sleeping && T1CONbits.TMR1ON && T1CONbits.TMR1CS == 0;
+}
+
+static unsigned long long timer1_next(void)
+{
+    if (!timer1_running()) {
+        return HAL_NEVER;
+    }
+    return hal_time_ns + (65536 - (TMR1H << 8 | TMR1L)) * timer1_tick_ns() - t1_residual;
+}
+
+static void timer1_elapse(unsigned long long ns)
+{
+    unsigned long long tick = timer1_tick_ns();
+    unsigned long long ticks;
+    unsigned int tmr1;
+
+    if (!timer1_running()) {
+        t1_residual = 0;                // the prescaler is cleared
+        return;
+    }
+    t1_residual += ns;
+    ticks = t1_residual / tick;
+    t1_residual %= tick;
+    tmr1 = (TMR1H << 8 | TMR1L) + ticks;
+    if (tmr1 >= 65536) {
+        TMR1IF = 1;
+    }
+    TMR1H = (unsigned char)(tmr1 >> 8);
+    TMR1L = (unsigned char)tmr1;
+}
+
+/**
+ * !@brief Period of the WDT from WDTCON (LFINTOSC 31kHz off by hal_lfosc_ppm)
+ */
+static unsigned long long wdt_period_ns(void)
+{
+    return (32ULL << ((WDTCON >> 1) & 0x1f)) * 1000000000ULL / 31000ULL * 1000000ULL /
+           (unsigned long long)(1000000 + hal_lfosc_ppm);
+}
+
+/**
+ * !@brief Advance the virtual time and run the model
+ *
+ * Returns at 'end' or, when sleeping, at wake up.
+ */
+static void hal_advance(unsigned long long end)
+{
+    hal_model_t *m;
+    unsigned long long next, t;
+    unsigned long long wdt = HAL_NEVER;
+
+    if (hal_sleeping && SWDTEN) {
+        wdt = hal_time_ns + wdt_period_ns();
+    }
+
+    hal_update();
+    if (!hal_sleeping) {
+        mssp_begin();
+        uart_begin();
+        adc_begin();
+        hal_interrupt();
+    }
+    while (hal_time_ns < end) {
+        next = end;
+        if (!hal_sleeping && mssp_op != MSSP_IDLE && mssp_done < next) {
+            next = mssp_done;
+        }
+        if (!hal_sleeping && uart_tx_done < next) {
+            next = uart_tx_done;
+        }
+        if (uart_rx_at < next) {
+            next = uart_rx_at;
+        }
+        if (!hal_sleeping && adc_done < next) {
+            next = adc_done;
+        }
+        t = timer0_next();
+        if (t < next) {
+            next = t;
+        }
+        t = timer1_next();
+        if (t < next) {
+            next = t;
+        }
+        for (m = models; m; m = m->next) {
+            t = m->next_event(m);
+            if (t < next) {
+                next = t;
+            }
+        }
+        if (wdt < next) {
+            next = wdt;
+        }
+        if (next > hal_time_limit_ns) {
+            next = hal_time_limit_ns;
+        }
+        if (hal_sleeping) {
+            hal_stats.sleep_ns += next - hal_time_ns;
+        }
+        timer0_elapse(next - hal_time_ns);
+        timer1_elapse(next - hal_time_ns);
+        if (next == hal_time_limit_ns && next < end) {
+            hal_time_ns = next;
+            longjmp(hal_exit, 1);
+        }
+        hal_time_ns = next;
+
+        if (!hal_sleeping && mssp_op != MSSP_IDLE && mssp_done <= hal_time_ns) {
+            mssp_complete();
+        }
+        if (!hal_sleeping && uart_tx_done <= hal_time_ns) {
+            uart_complete();
+        }
+        if (uart_rx_at <= hal_time_ns) {
+            uart_rx_edge();
+        }
+        if (!hal_sleeping && adc_done <= hal_time_ns) {
+            adc_complete();
+        }
+        for (m = models; m; m = m->next) {
+            if (m->next_event(m) <= hal_time_ns) {
+                m->run(m);
+            }
+        }
+        hal_update();
+        if (hal_sleeping) {
+            if (hal_wake_pending()) {
+                return;                 // wake up
+            }
+            if (hal_time_ns >= wdt) {
+                nTO = 0;
+                return;                 // wake up by WDT time-out
+            }
+        } else {
+            mssp_begin();
+            uart_begin();
+            adc_begin();
+            hal_interrupt();
+        }
+    }
+}
+
+/**
+ * !@brief Busy wait (__delay_us, __delay_ms, HAL_POLL)
+ */
+void hal_delay_ns(unsigned long long ns)
+{
+    hal_advance(hal_time_ns + osc_ns(ns));
+}
+
+/**
+ * !@brief SLEEP instruction
+ *
+ * Timer0/1, MSSP, the EUSART and the ADC stop. Wake up by Interrupt-on-Change, the
+ * auto-wake of the EUSART or, with SWDTEN, by the WDT time-out (nTO = 0).
+ * With the flag of an enabled interrupt already set, it is NOP (nTO and
+ * nPD kept). The WDT reset while awake isn't modelled.
+ */
+void hal_sleep(void)
+{
+    unsigned long long start = hal_time_ns;
+
+    hal_update();
+    if (hal_wake_pending()) {
+        hal_delay_ns(HAL_TCY_NS);
+        return;
+    }
+    nTO = 1;
+    nPD = 0;
+    hal_sleeping = 1;
+    hal_update();
+    if (!hal_wake_pending()) {
+        hal_advance(HAL_NEVER);
+    }
+    hal_sleeping = 0;
+    if (mssp_op != MSSP_IDLE) {
+        mssp_done += hal_time_ns - start;   // MSSP was stopped as well
+    }
+    if (uart_tx_done != HAL_NEVER) {
+        uart_tx_done += hal_time_ns - start;
+    }
+    if (adc_done != HAL_NEVER) {
+        adc_done += hal_time_ns - start;
+    }
+    if (SWDTEN) {
+        hal_stats.naps++;
+    } else {
+        hal_stats.wakeups++;
+    }
+    hal_advance(hal_time_ns);           // interrupt after wake up
+}
+
+/**
+ * !@brief Whether the MCU is in SLEEP
+ */
+int hal_is_sleeping(void)
+{
+    return hal_sleeping;
+}
+
+/**
+ * !@brief Run the firmware until hal_time_limit_ns
+ *
+ * @param[in] entry Entry of the firmware (main() of main.c)
+ * @return 0 when the time limit reached, 1 when the firmware returned
+ */
+int hal_run(void (*entry)(void))
+{
+    if (setjmp(hal_exit) != 0) {
+        return 0;
+    }
+    entry();
+    return 1;
+}
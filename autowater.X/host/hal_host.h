@@ -0,0 +1,297 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Host implementation of the hardware abstraction layer
+//  - Included through hal.h when HAL_HOST is defined (see host/Makefile).
+//  - SFRs of PIC12F1822 used by the firmware are plain variables.
+//    Bit names are the same as <xc.h>, so sources don't need to change.
+//  - Time is virtual. __delay_us/ms, HAL_POLL() and SLEEP() advance it and
+//    run the peripheral model (Timer0/1, IOC, MSSP, EUSART, ADC, WDT) in hal_host.c.
+//  - INTOSC runs off by hal_osc_ppm plus the trim of OSCTUNE, all the timing
+//    of the MCU clock follows it.
+
+#ifndef _HAL_HOST_H_
+#define _HAL_HOST_H_
+
+#define HAL_FOSC          8000000ULL                  // INTOSC 8MHz
+#define HAL_TCY_NS        (4000000000ULL / HAL_FOSC)  // 500ns
+#define HAL_POLL_CYCLES   15                          // cycles of one poll
+#define HAL_OSCTUNE_PPM   3500                        // step of OSCTUNE (about +-11%)
+
+// SFR index
+enum {
+    HAL_PORTA,
+    HAL_LATA,
+    HAL_TRISA,
+    HAL_ANSELA,
+    HAL_WPUA,
+    HAL_OPTION_REG,
+    HAL_OSCCON,
+    HAL_TMR0,
+    HAL_INTCON,
+    HAL_PIR1,
+    HAL_PIR2,
+    HAL_PIE1,
+    HAL_PIE2,
+    HAL_IOCAP,
+    HAL_IOCAN,
+    HAL_IOCAF,
+    HAL_SSP1ADD,
+    HAL_SSP1STAT,
+    HAL_SSP1CON1,
+    HAL_SSP1CON2,
+    HAL_SSP1CON3,
+    HAL_WDTCON,
+    HAL_STATUS,
+    HAL_TXSTA,
+    HAL_RCSTA,
+    HAL_BAUDCON,
+    HAL_SPBRGL,
+    HAL_SPBRGH,
+    HAL_APFCON,
+    HAL_ADCON0,
+    HAL_ADCON1,
+    HAL_ADRESL,
+    HAL_ADRESH,
+    HAL_FVRCON,
+    HAL_OSCTUNE,
+    HAL_T1CON,
+    HAL_TMR1L,
+    HAL_TMR1H,
+    HAL_SFR_COUNT
+};
+
+// SFR with the bit names of <xc.h>
+typedef union {
+    unsigned char val;
+    struct {
+        unsigned b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1;
+    };
+    struct {    // SSP1STAT
+        unsigned BF:1, UA:1, R_nW:1, S:1, P:1, D_nA:1, CKE:1, SMP:1;
+    };
+    struct {    // SSP1CON1
+        unsigned SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1;
+    };
+    struct {    // SSP1CON2
+        unsigned SEN:1, RSEN:1, PEN:1, RCEN:1, ACKEN:1, ACKDT:1, ACKSTAT:1, GCEN:1;
+    };
+    struct {    // TXSTA
+        unsigned TX9D:1, TRMT:1, BRGH:1, SENDB:1, SYNC:1, TXEN:1, TX9:1, CSRC:1;
+    };
+    struct {    // RCSTA
+        unsigned RX9D:1, OERR:1, FERR:1, ADDEN:1, CREN:1, SREN:1, RX9:1, SPEN:1;
+    };
+    struct {    // BAUDCON
+        unsigned ABDEN:1, WUE:1, :1, BRG16:1, SCKP:1, :1, RCIDL:1, ABDOVF:1;
+    };
+    struct {    // ADCON0
+        unsigned ADON:1, GO_nDONE:1, CHS:5, :1;
+    };
+    struct {    // ADCON1
+        unsigned ADPREF:2, :2, ADCS:3, ADFM:1;
+    };
+    struct {    // T1CON
+        unsigned TMR1ON:1, :1, nT1SYNC:1, T1OSCEN:1, T1CKPS:2, TMR1CS:2;
+    };
+    struct {    // FVRCON
+        unsigned ADFVR:2, CDAFVR:2, TSRNG:1, TSEN:1, FVRRDY:1, FVREN:1;
+    };
+} hal_sfr_t;
+
+extern volatile hal_sfr_t hal_sfr[HAL_SFR_COUNT];
+
+// SSP1BUF is wider than the PIC register.
+// Bit 8 is set while it holds the value from MSSP (received or consumed),
+// so the model can tell the firmware wrote a new byte to send.
+extern volatile unsigned short hal_ssp1buf;
+
+// TXREG is wide as well. Bit 8 is set while it is empty (TXIF).
+// Reading RCREG pops the receive FIFO.
+extern volatile unsigned short hal_txreg;
+unsigned char hal_uart_read(void);
+
+// Registers
+#define PORTA         (hal_sfr[HAL_PORTA].val)
+#define LATA          (hal_sfr[HAL_LATA].val)
+#define TRISA         (hal_sfr[HAL_TRISA].val)
+#define ANSELA        (hal_sfr[HAL_ANSELA].val)
+#define WPUA          (hal_sfr[HAL_WPUA].val)
+#define OPTION_REG    (hal_sfr[HAL_OPTION_REG].val)
+#define OSCCON        (hal_sfr[HAL_OSCCON].val)
+#define TMR0          (hal_sfr[HAL_TMR0].val)
+#define INTCON        (hal_sfr[HAL_INTCON].val)
+#define PIR1          (hal_sfr[HAL_PIR1].val)
+#define PIR2          (hal_sfr[HAL_PIR2].val)
+#define PIE1          (hal_sfr[HAL_PIE1].val)
+#define PIE2          (hal_sfr[HAL_PIE2].val)
+#define IOCAP         (hal_sfr[HAL_IOCAP].val)
+#define IOCAN         (hal_sfr[HAL_IOCAN].val)
+#define IOCAF         (hal_sfr[HAL_IOCAF].val)
+#define SSP1BUF       hal_ssp1buf
+#define SSP1ADD       (hal_sfr[HAL_SSP1ADD].val)
+#define SSP1STAT      (hal_sfr[HAL_SSP1STAT].val)
+#define SSP1CON1      (hal_sfr[HAL_SSP1CON1].val)
+#define SSP1CON2      (hal_sfr[HAL_SSP1CON2].val)
+#define SSP1CON3      (hal_sfr[HAL_SSP1CON3].val)
+#define WDTCON        (hal_sfr[HAL_WDTCON].val)
+#define STATUS        (hal_sfr[HAL_STATUS].val)
+#define TXSTA         (hal_sfr[HAL_TXSTA].val)
+#define RCSTA         (hal_sfr[HAL_RCSTA].val)
+#define BAUDCON       (hal_sfr[HAL_BAUDCON].val)
+#define SPBRGL        (hal_sfr[HAL_SPBRGL].val)
+#define SPBRGH        (hal_sfr[HAL_SPBRGH].val)
+#define APFCON        (hal_sfr[HAL_APFCON].val)
+#define ADCON0        (hal_sfr[HAL_ADCON0].val)
+#define ADCON1        (hal_sfr[HAL_ADCON1].val)
+#define ADRESL        (hal_sfr[HAL_ADRESL].val)
+#define ADRESH        (hal_sfr[HAL_ADRESH].val)
+#define FVRCON        (hal_sfr[HAL_FVRCON].val)
+#define OSCTUNE       (hal_sfr[HAL_OSCTUNE].val)
+#define T1CON         (hal_sfr[HAL_T1CON].val)
+#define TMR1L         (hal_sfr[HAL_TMR1L].val)
+#define TMR1H         (hal_sfr[HAL_TMR1H].val)
+#define TXREG         hal_txreg
+#define RCREG         hal_uart_read()
+#define SSP1STATbits  hal_sfr[HAL_SSP1STAT]
+#define SSP1CON1bits  hal_sfr[HAL_SSP1CON1]
+#define SSP1CON2bits  hal_sfr[HAL_SSP1CON2]
+#define TXSTAbits     hal_sfr[HAL_TXSTA]
+#define RCSTAbits     hal_sfr[HAL_RCSTA]
+#define BAUDCONbits   hal_sfr[HAL_BAUDCON]
+#define ADCON0bits    hal_sfr[HAL_ADCON0]
+#define ADCON1bits    hal_sfr[HAL_ADCON1]
+#define FVRCONbits    hal_sfr[HAL_FVRCON]
+#define T1CONbits     hal_sfr[HAL_T1CON]
+
+// Bits
+#define RA0           (hal_sfr[HAL_PORTA].b0)
+#define RA1           (hal_sfr[HAL_PORTA].b1)
+#define RA2           (hal_sfr[HAL_PORTA].b2)
+#define RA3           (hal_sfr[HAL_PORTA].b3)
+#define RA4           (hal_sfr[HAL_PORTA].b4)
+#define RA5           (hal_sfr[HAL_PORTA].b5)
+#define GIE           (hal_sfr[HAL_INTCON].b7)
+#define PEIE          (hal_sfr[HAL_INTCON].b6)
+#define TMR0IE        (hal_sfr[HAL_INTCON].b5)
+#define IOCIE         (hal_sfr[HAL_INTCON].b3)
+#define TMR0IF        (hal_sfr[HAL_INTCON].b2)
+#define IOCIF         (hal_sfr[HAL_INTCON].b0)
+#define T0IE          TMR0IE
+#define T0IF          TMR0IF
+#define TMR1IF        (hal_sfr[HAL_PIR1].b0)
+#define TMR1IE        (hal_sfr[HAL_PIE1].b0)
+#define SSP1IF        (hal_sfr[HAL_PIR1].b3)
+#define SSP1IE        (hal_sfr[HAL_PIE1].b3)
+#define TXIF          (hal_sfr[HAL_PIR1].b4)
+#define RCIF          (hal_sfr[HAL_PIR1].b5)
+#define TXIE          (hal_sfr[HAL_PIE1].b4)
+#define RCIE          (hal_sfr[HAL_PIE1].b5)
+#define ADIF          (hal_sfr[HAL_PIR1].b6)
+#define ADIE          (hal_sfr[HAL_PIE1].b6)
+#define BCL1IF        (hal_sfr[HAL_PIR2].b3)
+#define BCL1IE        (hal_sfr[HAL_PIE2].b3)
+#define SWDTEN        (hal_sfr[HAL_WDTCON].b0)
+#define nPD           (hal_sfr[HAL_STATUS].b3)
+#define nTO           (hal_sfr[HAL_STATUS].b4)
+
+// Compiler built-ins
+#define interrupt
+#define __delay_us(x) hal_delay_ns((unsigned long long)(x) * 1000ULL)
+#define __delay_ms(x) hal_delay_ns((unsigned long long)(x) * 1000000ULL)
+#define SLEEP()       hal_sleep()
+#define NOP()         hal_delay_ns(HAL_TCY_NS)
+#define CLRWDT()      (nTO = 1, nPD = 1)
+#define HAL_POLL()    hal_delay_ns(HAL_POLL_CYCLES * HAL_TCY_NS)
+
+// EEPROM: __EEPROM_DATA() of the firmware gives the first 8 bytes, others are 0xff
+#define __EEPROM_DATA(a,b,c,d,e,f,g,h) \
+    const unsigned char hal_eeprom_data[8] = {a,b,c,d,e,f,g,h}
+#define HAL_EEPROM_SIZE   256
+#define HAL_EEPROM_WRITE_NS 4000000ULL                // erase and write (typ. 4ms)
+unsigned char eeprom_read(unsigned char addr);
+void eeprom_write(unsigned char addr, unsigned char value);
+
+/**
+ * I2C slave device model attached to MSSP
+ */
+typedef struct hal_i2c_device {
+    unsigned char addr;                             // 7bit slave address
+    void (*start)(struct hal_i2c_device *dev, unsigned char rw);
+    unsigned char (*write)(struct hal_i2c_device *dev, unsigned char dt); // return 0:ACK 1:NACK
+    unsigned char (*read)(struct hal_i2c_device *dev);
+    void (*stop)(struct hal_i2c_device *dev);
+    struct hal_i2c_device *next;
+} hal_i2c_device_t;
+
+/**
+ * Timed model (e.g. RTC, button script) driven by the virtual clock
+ */
+typedef struct hal_model {
+    unsigned long long (*next_event)(struct hal_model *m);   // HAL_NEVER if none
+    void (*run)(struct hal_model *m);                       // called at next_event
+    struct hal_model *next;
+} hal_model_t;
+
+#define HAL_NEVER     (~0ULL)
+
+/**
+ * Statistics of the run
+ */
+typedef struct {
+    unsigned long wakeups;              // count of wake up from SLEEP
+    unsigned long naps;                 // count of SLEEP with the WDT (not in wakeups)
+    unsigned long long sleep_ns;        // time in SLEEP
+    unsigned long isr_count;            // entries of interrupt_func
+    unsigned long i2c_transactions;     // start conditions (not repeated)
+    unsigned long i2c_bytes;            // bytes sent and received
+    unsigned long long i2c_busy_ns;     // time the MSSP was driving the bus
+    unsigned long uart_tx_bytes;        // bytes sent by the EUSART
+    unsigned long uart_rx_bytes;        // bytes received (not the waking ones)
+    unsigned long uart_overruns;        // bytes lost by OERR or in sleep
+    unsigned long adc_conversions;      // conversions of the ADC
+} hal_stats_t;
+
+extern hal_stats_t hal_stats;
+extern void (*hal_watch)(void);                 // called when the model updates pins
+extern void (*hal_uart_out)(unsigned char dt);  // called when a byte was sent
+extern unsigned short (*hal_adc_in)(unsigned char ch); // analog input (0-1023), 0 if NULL
+
+extern unsigned long long hal_time_ns;          // virtual time
+extern unsigned long long hal_time_limit_ns;    // run ends at this time
+extern long hal_osc_ppm;                        // error of INTOSC without OSCTUNE
+extern long hal_lfosc_ppm;                      // error of LFINTOSC (the WDT)
+
+void hal_reset(void);
+void hal_delay_ns(unsigned long long ns);
+long hal_osc_error(void);
+void hal_sleep(void);
+int  hal_is_sleeping(void);
+void hal_set_pin(unsigned char mask, unsigned char level);
+unsigned char hal_pullup_lo(void);
+unsigned char hal_floating(void);
+void hal_uart_rx(unsigned char dt);
+void hal_i2c_attach(hal_i2c_device_t *dev);
+void hal_model_attach(hal_model_t *m);
+int  hal_run(void (*entry)(void));
+
+#endif
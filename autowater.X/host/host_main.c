@@ -0,0 +1,50 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Host entry of the firmware
+//  - main() of main.c is renamed to firmware_main by host/Makefile.
+//  - Usage: autowater [seconds]
+//    Runs the firmware for the virtual seconds (default 60) and prints
+//    the virtual time and the wall time it took.
+//  - No i2c slaves are attached, so every transaction is NACKed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "hal_host.h"
+
+void firmware_main(void);
+
+int main(int argc, char *argv[])
+{
+    double seconds = (argc > 1) ? atof(argv[1]) : 60.0;
+    clock_t wall;
+
+    hal_reset();
+    hal_time_limit_ns = (unsigned long long)(seconds * 1e9);
+    wall = clock();
+    hal_run(firmware_main);
+    wall = clock() - wall;
+    printf("virtual %.3f s, wall %.3f ms\n",
+           hal_time_ns / 1e9, wall * 1000.0 / CLOCKS_PER_SEC);
+    return 0;
+}
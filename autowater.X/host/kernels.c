@@ -0,0 +1,181 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Harness of the BCD/formatting kernels of rtc_8564nb.c
+//  - Built once per variant (BCD_KERNEL, SHARED_EMITTER), see Makefile.
+//  - Checks bcd2bin(), bin2bcd(), set_ctime() and rtc_time_to_string()
+//    against a reference over every input of their domain, and bcd2bin()
+//    over every byte (0xff on an I2C error).
+//  - Measures the host time per call. This only ranks the variants roughly,
+//    the sizes on the PIC come from the XC8 funclist/map (bench/funcsize.sh).
+//
+// Usage: kernels_<variant>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "../rtc_8564nb.h"
+
+unsigned char bcd2bin(unsigned char dt);
+unsigned char bin2bcd(unsigned char num);
+
+#define GUARD       0xa5
+#define BENCH_LOOP  200
+
+static int errors;
+
+static void fail(const char *func, int in, const char *msg)
+{
+    if (errors++ < 10) {
+        printf("  FAIL %s(%d): %s\n", func, in, msg);
+    }
+}
+
+/**
+ * !@brief Reference of set_ctime()
+ */
+static void ref_ctime(int num, char prefix, char *out)
+{
+    if (prefix != '\0') {
+        *out++ = prefix;
+    }
+    *out++ = '0' + num / 10;
+    *out = '0' + num % 10;
+}
+
+static void check_bcd(void)
+{
+    for (int n=0; n<100; n++) {
+        int bcd = ((n / 10) << 4) | (n % 10);
+        if (bin2bcd(n) != bcd) {
+            fail("bin2bcd", n, "wrong value");
+        }
+        if (bcd2bin(bcd) != n) {
+            fail("bcd2bin", bcd, "wrong value");
+        }
+    }
+    // the unmasked year and 0xff of an I2C error reach bcd2bin()
+    for (int dt=0; dt<256; dt++) {
+        if (bcd2bin(dt) != (dt >> 4) * 10 + (dt & 0xf)) {
+            fail("bcd2bin", dt, "not the original for a non-BCD byte");
+        }
+        if ((bin2bcd(dt) & 0x0f) > 9) {
+            fail("bin2bcd", dt, "ones digit over 9");
+        }
+    }
+}
+
+static void check_ctime(void)
+{
+    static const char prefixes[] = {'\0', ':', ' ', '0'};
+    char out[8], ref[8];
+
+    for (int p=0; p<4; p++) {
+        for (int n=0; n<100; n++) {
+            memset(out, GUARD, sizeof(out));
+            memset(ref, GUARD, sizeof(ref));
+            set_ctime(n, prefixes[p], &out[2]);
+            ref_ctime(n, prefixes[p], &ref[2]);
+            if (memcmp(out, ref, sizeof(out)) != 0) {
+                fail("set_ctime", n, "wrong string or out of range write");
+            }
+        }
+    }
+}
+
+static void ref_time_to_string(const unsigned char *tm, char *c)
+{
+    // the prefix of the hour overwrites the terminator of the date
+    sprintf(c, "20%02u%02u%02u %02u:%02u:%02u",
+            tm[6] % 100, tm[5] % 100, tm[3] % 100, tm[2] % 100, tm[1] % 100, tm[0] % 100);
+}
+
+static void check_time_to_string(void)
+{
+    // every value of each field, the other fields changing with it
+    for (int f=0; f<7; f++) {
+        for (int n=0; n<100; n++) {
+            char tm[7], out[20], ref[20];
+            for (int i=0; i<7; i++) {
+                tm[i] = (n * 37 + i * 11) % 100;
+            }
+            tm[f] = n;
+            memset(out, GUARD, sizeof(out));
+            memset(ref, GUARD, sizeof(ref));
+            rtc_time_to_string(tm, out);
+            ref_time_to_string((unsigned char *)tm, ref);
+            if (memcmp(out, ref, sizeof(out)) != 0) {
+                fail("rtc_time_to_string", f * 100 + n, "wrong string or out of range write");
+            }
+        }
+    }
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char *argv[])
+{
+    volatile unsigned char sink = 0;
+    char tm[7] = {20, 29, 13, 31, 2, 5, 11};
+    char out[20];
+    double t;
+
+    printf("%s\n", argc > 0 ? argv[0] : "kernels");
+    check_bcd();
+    check_ctime();
+    check_time_to_string();
+    printf("  exhaustive check: %s\n", errors ? "FAILED" : "ok");
+
+    t = now_ns();
+    for (int l=0; l<BENCH_LOOP; l++) {
+        for (int n=0; n<100; n++) {
+            sink += bin2bcd(n);
+            __asm__ volatile("" ::: "memory");
+        }
+    }
+    printf("  bin2bcd            %7.2f ns/call (host)\n", (now_ns() - t) / (BENCH_LOOP * 100));
+
+    t = now_ns();
+    for (int l=0; l<BENCH_LOOP; l++) {
+        for (int n=0; n<100; n++) {
+            sink += bcd2bin(((n / 10) << 4) | (n % 10));
+            __asm__ volatile("" ::: "memory");
+        }
+    }
+    printf("  bcd2bin            %7.2f ns/call (host)\n", (now_ns() - t) / (BENCH_LOOP * 100));
+
+    t = now_ns();
+    for (int l=0; l<BENCH_LOOP * 100; l++) {
+        tm[0] = l % 60;
+        rtc_time_to_string(tm, out);
+        sink += out[16];
+        __asm__ volatile("" ::: "memory");
+    }
+    printf("  rtc_time_to_string %7.2f ns/call (host)\n", (now_ns() - t) / (BENCH_LOOP * 100));
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,810 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Instruction-set simulator of PIC14E (see pic14e.h)
+
+#include <stdio.h>
+#include <string.h>
+#include "pic14e.h"
+
+#define REG(a)        p->data[a]
+#define W             REG(PIC_WREG)
+
+// STATUS
+#define ST_C          0x01
+#define ST_DC         0x02
+#define ST_Z          0x04
+#define ST_nPD        0x08
+#define ST_nTO        0x10
+// INTCON
+#define IC_GIE        0x80
+#define IC_PEIE       0x40
+#define IC_TMR0IE     0x20
+#define IC_IOCIE      0x08
+#define IC_TMR0IF     0x04
+#define IC_IOCIF      0x01
+// SSP1CON2
+#define SSP_SEN       0x01
+#define SSP_RSEN      0x02
+#define SSP_PEN       0x04
+#define SSP_RCEN      0x08
+#define SSP_ACKEN     0x10
+#define SSP_ACKSTAT   0x40
+// SSP1STAT
+#define SSP_BF        0x01
+#define SSP_R_nW      0x04
+#define SSP_S         0x08
+#define SSP_P         0x10
+#define SSP1IF        0x08          // PIR1
+
+// MSSP operations, the length is in SCL periods
+enum { OP_IDLE, OP_START, OP_RSTART, OP_STOP, OP_RECEIVE, OP_ACK, OP_SEND };
+static const unsigned char op_periods[] = {0, 1, 2, 1, 8, 1, 9};
+
+/**
+ * !@brief Address of the data memory by BSR
+ */
+static unsigned short direct(pic14e_t *p, unsigned char f)
+{
+    f &= 0x7f;
+    if (f < 0x0c || f >= 0x70) {
+        return f;                   // core registers, common RAM
+    }
+    return (REG(PIC_BSR) & 0x1f) * 128 + f;
+}
+
+static unsigned short fsr(pic14e_t *p, int n)
+{
+    return REG(PIC_FSR0L + 2 * n) | (REG(PIC_FSR0L + 2 * n + 1) << 8);
+}
+
+static void set_fsr(pic14e_t *p, int n, unsigned short v)
+{
+    REG(PIC_FSR0L + 2 * n) = v & 0xff;
+    REG(PIC_FSR0L + 2 * n + 1) = v >> 8;
+}
+
+static unsigned char iocif(pic14e_t *p)
+{
+    if (REG(PIC_IOCAF) & 0x3f) {
+        REG(PIC_INTCON) |= IC_IOCIF;
+    } else {
+        REG(PIC_INTCON) &= ~IC_IOCIF;
+    }
+    return REG(PIC_INTCON);
+}
+
+static unsigned char rd(pic14e_t *p, unsigned short a);
+static void wr(pic14e_t *p, unsigned short a, unsigned char v);
+
+/**
+ * !@brief Data address of FSR: traditional, linear or program memory
+ *
+ * @return 0: data at *addr, 1: program memory at *addr, -1: nothing
+ */
+static int indirect(unsigned short f, unsigned short *addr)
+{
+    if (f & 0x8000) {
+        *addr = f & (PIC_PROG_WORDS - 1);
+        return 1;
+    }
+    if (f < 0x1000) {
+        *addr = f;
+        return ((f & 0x7f) <= PIC_INDF1) ? -1 : 0;
+    }
+    if (f >= 0x2000 && f < 0x2000 + 80 * 32) {
+        f -= 0x2000;
+        *addr = (f / 80) * 128 + 0x20 + f % 80;
+        return 0;
+    }
+    return -1;
+}
+
+static unsigned char rd_fsr(pic14e_t *p, unsigned short f, int *cycles)
+{
+    unsigned short a;
+
+    switch (indirect(f, &a)) {
+    case 0:
+        return rd(p, a);
+    case 1:
+        (*cycles)++;                // a cycle more to read the program memory
+        return p->prog[a] & 0xff;
+    }
+    return 0;
+}
+
+static void wr_fsr(pic14e_t *p, unsigned short f, unsigned char v)
+{
+    unsigned short a;
+
+    if (indirect(f, &a) == 0) {
+        wr(p, a, v);
+    }
+}
+
+static unsigned char rd(pic14e_t *p, unsigned short a)
+{
+    int dummy = 0;
+
+    if ((a & 0x7f) < 0x0c || (a & 0x7f) >= 0x70) {
+        a &= 0x7f;
+    }
+    switch (a) {
+    case PIC_INDF0:
+    case PIC_INDF1:
+        return rd_fsr(p, fsr(p, a), &dummy);
+    case PIC_PCL:
+        return p->pc & 0xff;
+    case PIC_INTCON:
+        return iocif(p);
+    case PIC_PORTA:
+        return ((REG(PIC_LATA) & ~REG(PIC_TRISA)) | (p->pins & REG(PIC_TRISA))) & 0x3f;
+    case PIC_SSP1BUF:
+        REG(PIC_SSP1STAT) &= ~SSP_BF;
+        break;
+    }
+    return REG(a);
+}
+
+static void ssp_begin(pic14e_t *p, int op)
+{
+    p->ssp_op = op;
+    p->ssp_left = (unsigned long)op_periods[op] * (REG(PIC_SSP1ADD) + 1);
+}
+
+/**
+ * !@brief End of the operation of MSSP: the bus and the slave
+ */
+static void ssp_end(pic14e_t *p)
+{
+    pic_i2c_device_t *dev;
+    unsigned char ack = 1;
+
+    switch (p->ssp_op) {
+    case OP_START:
+    case OP_RSTART:
+        REG(PIC_SSP1CON2) &= ~(SSP_SEN | SSP_RSEN);
+        REG(PIC_SSP1STAT) = (REG(PIC_SSP1STAT) & ~SSP_P) | SSP_S;
+        p->ssp_first = 1;
+        break;
+    case OP_STOP:
+        REG(PIC_SSP1CON2) &= ~SSP_PEN;
+        REG(PIC_SSP1STAT) = (REG(PIC_SSP1STAT) & ~SSP_S) | SSP_P;
+        if (p->selected && p->selected->stop) {
+            p->selected->stop(p->selected);
+        }
+        p->selected = NULL;
+        break;
+    case OP_RECEIVE:
+        REG(PIC_SSP1CON2) &= ~SSP_RCEN;
+        REG(PIC_SSP1BUF) = (p->selected && p->selected->read) ? p->selected->read(p->selected) : 0xff;
+        REG(PIC_SSP1STAT) |= SSP_BF;
+        break;
+    case OP_ACK:
+        REG(PIC_SSP1CON2) &= ~SSP_ACKEN;
+        break;
+    case OP_SEND:
+        if (p->ssp_first) {
+            p->ssp_first = 0;
+            p->selected = NULL;
+            for (dev = p->devices; dev; dev = dev->next) {
+                if (dev->addr == (p->ssp_tx >> 1)) {
+                    p->selected = dev;
+                    if (dev->start) {
+                        dev->start(dev, p->ssp_tx & 1);
+                    }
+                    ack = 0;
+                }
+            }
+        } else if (p->selected && p->selected->write) {
+            ack = p->selected->write(p->selected, p->ssp_tx);
+        }
+        REG(PIC_SSP1STAT) &= ~(SSP_BF | SSP_R_nW);
+        REG(PIC_SSP1CON2) = (REG(PIC_SSP1CON2) & ~SSP_ACKSTAT) | (ack ? SSP_ACKSTAT : 0);
+        break;
+    }
+    p->ssp_op = OP_IDLE;
+    REG(PIC_PIR1) |= SSP1IF;
+}
+
+static void wr(pic14e_t *p, unsigned short a, unsigned char v)
+{
+    unsigned char bits;
+
+    if ((a & 0x7f) < 0x0c || (a & 0x7f) >= 0x70) {
+        a &= 0x7f;
+    }
+    switch (a) {
+    case PIC_INDF0:
+    case PIC_INDF1:
+        wr_fsr(p, fsr(p, a), v);
+        return;
+    case PIC_PCL:
+        p->pc = ((REG(PIC_PCLATH) << 8) | v) & 0x7fff;
+        return;
+    case PIC_STATUS:
+        REG(a) = (REG(a) & (ST_nPD | ST_nTO)) | (v & (ST_C | ST_DC | ST_Z));
+        return;
+    case PIC_BSR:
+        REG(a) = v & 0x1f;
+        return;
+    case PIC_PCLATH:
+        REG(a) = v & 0x7f;
+        return;
+    case PIC_PORTA:
+    case PIC_LATA:
+        REG(PIC_LATA) = v & 0x3f;
+        return;
+    case PIC_TMR0:
+        REG(a) = v;
+        p->t0_prescaler = 0;
+        p->t0_inhibit = 2;
+        return;
+    case PIC_SSP1BUF:
+        REG(a) = v;
+        if (p->ssp_op == OP_IDLE) {
+            p->ssp_tx = v;
+            REG(PIC_SSP1STAT) |= SSP_BF | SSP_R_nW;
+            ssp_begin(p, OP_SEND);
+        }
+        return;
+    case PIC_SSP1CON2:
+        REG(a) = (v & ~SSP_ACKSTAT) | (REG(a) & SSP_ACKSTAT);
+        bits = v & (SSP_SEN | SSP_RSEN | SSP_PEN | SSP_RCEN | SSP_ACKEN);
+        if (p->ssp_op == OP_IDLE && bits) {
+            ssp_begin(p, (bits & SSP_SEN) ? OP_START : (bits & SSP_RSEN) ? OP_RSTART :
+                         (bits & SSP_PEN) ? OP_STOP : (bits & SSP_RCEN) ? OP_RECEIVE : OP_ACK);
+        }
+        return;
+    }
+    REG(a) = v;
+}
+
+/**
+ * !@brief Advance the clock and the peripherals by the cycles
+ */
+static void tick(pic14e_t *p, int n)
+{
+    unsigned char opt = REG(PIC_OPTION_REG);
+
+    p->cycles += n;
+    p->time += n;
+    for (int i = 0; i < n && (opt & 0x20) == 0; i++) {  // T0CS: Fosc/4
+        if (p->t0_inhibit) {
+            p->t0_inhibit--;
+            continue;
+        }
+        if ((opt & 0x08) == 0 && ++p->t0_prescaler < (2u << (opt & 7))) {
+            continue;
+        }
+        p->t0_prescaler = 0;
+        if (++REG(PIC_TMR0) == 0) {
+            REG(PIC_INTCON) |= IC_TMR0IF;
+        }
+    }
+    if (p->ssp_op != OP_IDLE) {
+        if (p->ssp_left <= (unsigned long)n) {
+            ssp_end(p);
+        } else {
+            p->ssp_left -= n;
+        }
+    }
+}
+
+/**
+ * !@brief Whether an enabled interrupt is requested (GIE aside)
+ */
+static int irq(pic14e_t *p)
+{
+    unsigned char ic = iocif(p);
+
+    return ((ic & IC_TMR0IE) && (ic & IC_TMR0IF)) ||
+           ((ic & IC_IOCIE) && (ic & IC_IOCIF)) ||
+           ((ic & IC_PEIE) && ((REG(PIC_PIR1) & REG(PIC_PIE1)) || (REG(PIC_PIR2) & REG(PIC_PIE2))));
+}
+
+static int push(pic14e_t *p, unsigned short pc)
+{
+    if (p->sp == PIC_STACK) {
+        fprintf(stderr, "pic14e: stack overflow at %04X\n", p->pc);
+        return -1;
+    }
+    p->stack[p->sp++] = pc;
+    return 0;
+}
+
+static int pop(pic14e_t *p)
+{
+    if (p->sp == 0) {
+        fprintf(stderr, "pic14e: stack underflow at %04X\n", p->pc);
+        return -1;
+    }
+    p->pc = p->stack[--p->sp];
+    if (p->on_return) {
+        p->on_return(p);
+    }
+    return 0;
+}
+
+static void flags(pic14e_t *p, unsigned char mask, unsigned char v)
+{
+    REG(PIC_STATUS) = (REG(PIC_STATUS) & ~mask) | (v & mask);
+}
+
+static unsigned char zero(pic14e_t *p, unsigned char r)
+{
+    flags(p, ST_Z, r ? 0 : ST_Z);
+    return r;
+}
+
+static unsigned char add(pic14e_t *p, unsigned a, unsigned b, unsigned c)
+{
+    unsigned r = a + b + c;
+
+    flags(p, ST_C | ST_DC | ST_Z, ((r > 0xff) ? ST_C : 0) |
+          ((((a & 0xf) + (b & 0xf) + c) > 0xf) ? ST_DC : 0) | ((r & 0xff) ? 0 : ST_Z));
+    return r & 0xff;
+}
+
+static signed short sext(unsigned short v, int bits)
+{
+    return (v & (1 << (bits - 1))) ? (signed short)(v - (1 << bits)) : (signed short)v;
+}
+
+/**
+ * !@brief Execute one instruction
+ *
+ * @return Cycles of it, -1 on error
+ */
+static int step(pic14e_t *p)
+{
+    unsigned short op = p->prog[p->pc & (PIC_PROG_WORDS - 1)];
+    unsigned short at = p->pc;
+    unsigned short a = direct(p, op & 0x7f);
+    int d = op & 0x80;                  // destination f
+    int cycles = 1;
+    int n;
+    unsigned short f;
+    unsigned char v, c = REG(PIC_STATUS) & ST_C;
+    unsigned char r = 0;
+    int store = 0;                      // 1: r to W or f by d
+
+    p->pc = (p->pc + 1) & 0x7fff;
+    switch (op >> 12) {
+    case 0:
+        switch ((op >> 8) & 0xf) {
+        case 0x0:
+            if (d) {                    // MOVWF
+                wr(p, a, W);
+                if (a == PIC_PCL) {
+                    cycles = 2;
+                }
+                break;
+            }
+            if (op == 0x0000 || op == 0x0064) {         // NOP, CLRWDT
+                if (op == 0x0064) {
+                    REG(PIC_STATUS) |= ST_nPD | ST_nTO;
+                }
+            } else if (op == 0x0001) {                  // RESET
+                pic_reset(p);
+            } else if (op == 0x0008) {                  // RETURN
+                cycles = 2;
+                if (pop(p) < 0) {
+                    return -1;
+                }
+            } else if (op == 0x0009) {                  // RETFIE
+                cycles = 2;
+                REG(PIC_STATUS) = (REG(PIC_STATUS) & ~7) | (p->shadow[0] & 7);
+                W = p->shadow[1];
+                REG(PIC_BSR) = p->shadow[2];
+                REG(PIC_PCLATH) = p->shadow[3];
+                memcpy(&REG(PIC_FSR0L), &p->shadow[4], 4);
+                REG(PIC_INTCON) |= IC_GIE;
+                if (pop(p) < 0) {
+                    return -1;
+                }
+            } else if (op == 0x000a) {                  // CALLW
+                cycles = 2;
+                if (push(p, p->pc) < 0) {
+                    return -1;
+                }
+                p->pc = (REG(PIC_PCLATH) << 8) | W;
+                if (p->on_call) {
+                    p->on_call(p, p->pc);
+                }
+            } else if (op == 0x000b) {                  // BRW
+                cycles = 2;
+                p->pc = (p->pc + W) & 0x7fff;
+            } else if ((op & 0x7f) >= 0x10 && (op & 0x7f) < 0x20) { // MOVIW, MOVWI ++/--
+                n = (op >> 2) & 1;
+                f = fsr(p, n);
+                if ((op & 3) == 0) {
+                    f++;
+                } else if ((op & 3) == 1) {
+                    f--;
+                }
+                if (op & 0x08) {
+                    wr_fsr(p, f, W);
+                } else {
+                    W = zero(p, rd_fsr(p, f, &cycles));
+                }
+                if ((op & 3) == 2) {
+                    f++;
+                } else if ((op & 3) == 3) {
+                    f--;
+                }
+                set_fsr(p, n, f);
+            } else if ((op & 0x7f) >= 0x20 && (op & 0x7f) < 0x40) { // MOVLB
+                REG(PIC_BSR) = op & 0x1f;
+            } else if (op == 0x0063) {                  // SLEEP
+                REG(PIC_STATUS) = (REG(PIC_STATUS) & ~ST_nPD) | ST_nTO;
+                p->sleeping = 1;
+                p->wdt_at = p->time + 1 + (2000ULL << ((REG(PIC_WDTCON) >> 1) & 0x1f));
+            } else if (op == 0x0062) {                  // OPTION
+                wr(p, PIC_OPTION_REG, W);
+            } else if (op >= 0x0065 && op <= 0x0067) {  // TRIS
+                if (op == 0x0065) {
+                    wr(p, PIC_TRISA, W);
+                }
+            } else {
+                fprintf(stderr, "pic14e: unknown opcode %04X at %04X\n", op, at);
+                return -1;
+            }
+            break;
+        case 0x1:                       // CLRF, CLRW
+            r = 0;
+            store = 1;
+            flags(p, ST_Z, ST_Z);
+            break;
+        case 0x2:                       // SUBWF
+            r = add(p, rd(p, a), ~W & 0xff, 1);
+            store = 1;
+            break;
+        case 0x3:                       // DECF
+            r = zero(p, rd(p, a) - 1);
+            store = 1;
+            break;
+        case 0x4:                       // IORWF
+            r = zero(p, rd(p, a) | W);
+            store = 1;
+            break;
+        case 0x5:                       // ANDWF
+            r = zero(p, rd(p, a) & W);
+            store = 1;
+            break;
+        case 0x6:                       // XORWF
+            r = zero(p, rd(p, a) ^ W);
+            store = 1;
+            break;
+        case 0x7:                       // ADDWF
+            r = add(p, rd(p, a), W, 0);
+            store = 1;
+            break;
+        case 0x8:                       // MOVF
+            r = zero(p, rd(p, a));
+            store = 1;
+            break;
+        case 0x9:                       // COMF
+            r = zero(p, ~rd(p, a));
+            store = 1;
+            break;
+        case 0xa:                       // INCF
+            r = zero(p, rd(p, a) + 1);
+            store = 1;
+            break;
+        case 0xb:                       // DECFSZ
+        case 0xf:                       // INCFSZ
+            r = rd(p, a) + ((op & 0x0f00) == 0x0b00 ? -1 : 1);
+            store = 1;
+            if (r == 0) {
+                cycles = 2;
+                p->pc = (p->pc + 1) & 0x7fff;
+            }
+            break;
+        case 0xc:                       // RRF
+            v = rd(p, a);
+            r = (v >> 1) | (c << 7);
+            flags(p, ST_C, v & 1);
+            store = 1;
+            break;
+        case 0xd:                       // RLF
+            v = rd(p, a);
+            r = (v << 1) | c;
+            flags(p, ST_C, v >> 7);
+            store = 1;
+            break;
+        case 0xe:                       // SWAPF
+            v = rd(p, a);
+            r = (v << 4) | (v >> 4);
+            store = 1;
+            break;
+        }
+        break;
+    case 1:                             // BCF, BSF, BTFSC, BTFSS
+        v = 1 << ((op >> 7) & 7);
+        switch ((op >> 10) & 3) {
+        case 0:
+            wr(p, a, rd(p, a) & ~v);
+            break;
+        case 1:
+            wr(p, a, rd(p, a) | v);
+            break;
+        case 2:
+        case 3:
+            if (((rd(p, a) & v) != 0) == ((op >> 10) & 1)) {
+                cycles = 2;
+                p->pc = (p->pc + 1) & 0x7fff;
+            }
+            break;
+        }
+        break;
+    case 2:                             // CALL, GOTO
+        cycles = 2;
+        if ((op & 0x0800) == 0 && push(p, p->pc) < 0) {
+            return -1;
+        }
+        p->pc = ((REG(PIC_PCLATH) & 0x78) << 8) | (op & 0x07ff);
+        if ((op & 0x0800) == 0 && p->on_call) {
+            p->on_call(p, p->pc);
+        }
+        break;
+    case 3:
+        v = op & 0xff;
+        switch ((op >> 8) & 0xf) {
+        case 0x0:                       // MOVLW
+            W = v;
+            break;
+        case 0x1:
+            if (op & 0x80) {            // MOVLP
+                REG(PIC_PCLATH) = op & 0x7f;
+            } else {                    // ADDFSR
+                n = (op >> 6) & 1;
+                set_fsr(p, n, fsr(p, n) + sext(op & 0x3f, 6));
+            }
+            break;
+        case 0x2:
+        case 0x3:                       // BRA
+            cycles = 2;
+            p->pc = (p->pc + sext(op & 0x1ff, 9)) & 0x7fff;
+            break;
+        case 0x4:                       // RETLW
+            cycles = 2;
+            W = v;
+            if (pop(p) < 0) {
+                return -1;
+            }
+            break;
+        case 0x5:                       // LSLF
+            v = rd(p, a);
+            flags(p, ST_C, v >> 7);
+            r = zero(p, v << 1);
+            store = 1;
+            break;
+        case 0x6:                       // LSRF
+            v = rd(p, a);
+            flags(p, ST_C, v & 1);
+            r = zero(p, v >> 1);
+            store = 1;
+            break;
+        case 0x7:                       // ASRF
+            v = rd(p, a);
+            flags(p, ST_C, v & 1);
+            r = zero(p, (v >> 1) | (v & 0x80));
+            store = 1;
+            break;
+        case 0x8:                       // IORLW
+            W = zero(p, W | v);
+            break;
+        case 0x9:                       // ANDLW
+            W = zero(p, W & v);
+            break;
+        case 0xa:                       // XORLW
+            W = zero(p, W ^ v);
+            break;
+        case 0xb:                       // SUBWFB
+            r = add(p, rd(p, a), ~W & 0xff, c);
+            store = 1;
+            break;
+        case 0xc:                       // SUBLW
+            W = add(p, v, ~W & 0xff, 1);
+            break;
+        case 0xd:                       // ADDWFC
+            r = add(p, rd(p, a), W, c);
+            store = 1;
+            break;
+        case 0xe:                       // ADDLW
+            W = add(p, W, v, 0);
+            break;
+        case 0xf:                       // MOVIW, MOVWI k[FSRn]
+            n = (op >> 6) & 1;
+            f = fsr(p, n) + sext(op & 0x3f, 6);
+            if (op & 0x80) {
+                wr_fsr(p, f, W);
+            } else {
+                W = zero(p, rd_fsr(p, f, &cycles));
+            }
+            break;
+        }
+        break;
+    }
+    if (store) {
+        if (d) {
+            unsigned char st = REG(PIC_STATUS);
+            wr(p, a, r);
+            if (a == PIC_STATUS) {
+                REG(PIC_STATUS) = (REG(PIC_STATUS) & ~(ST_C | ST_DC | ST_Z)) | (st & (ST_C | ST_DC | ST_Z));
+            }
+            if (a == PIC_PCL) {
+                cycles = 2;
+            }
+        } else {
+            W = r;
+        }
+    }
+    return cycles;
+}
+
+/**
+ * !@brief Power-on reset
+ */
+void pic_reset(pic14e_t *p)
+{
+    memset(p->data, 0, sizeof(p->data));
+    REG(PIC_STATUS) = ST_nPD | ST_nTO;
+    REG(PIC_TRISA) = 0x3f;
+    REG(PIC_OPTION_REG) = 0xff;
+    REG(PIC_WDTCON) = 0x16;
+    REG(PIC_SSP1STAT) = 0;
+    p->pc = 0;
+    p->sp = 0;
+    p->sleeping = 0;
+    p->skip_irq = 0;
+    p->t0_prescaler = 0;
+    p->t0_inhibit = 0;
+    p->ssp_op = OP_IDLE;
+    p->selected = NULL;
+    p->pins = 0x3f;                     // pulled up
+}
+
+/**
+ * !@brief Load the program memory from Intel HEX of XC8
+ *
+ * Bytes are little endian words, the configuration words are skipped.
+ * @return 0: success, -1: error
+ */
+int pic_load_hex(pic14e_t *p, const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[600];
+    unsigned long base = 0;
+    unsigned int len, addr, type, b;
+
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    for (int i = 0; i < PIC_PROG_WORDS; i++) {
+        p->prog[i] = 0x3fff;            // erased
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        if (line[0] != ':' || sscanf(line + 1, "%2x%4x%2x", &len, &addr, &type) != 3) {
+            continue;
+        }
+        if (type == 1) {
+            break;
+        } else if (type == 4 && sscanf(line + 9, "%4x", &b) == 1) {
+            base = (unsigned long)b << 16;
+        } else if (type == 0) {
+            for (unsigned int i = 0; i < len && sscanf(line + 9 + i * 2, "%2x", &b) == 1; i++) {
+                unsigned long byte = base + addr + i;
+                if (byte < PIC_PROG_WORDS * 2) {
+                    unsigned short *w = &p->prog[byte / 2];
+                    *w = (byte & 1) ? ((*w & 0xff) | ((b & 0x3f) << 8)) : ((*w & 0x3f00) | b);
+                }
+            }
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+void pic_i2c_attach(pic14e_t *p, pic_i2c_device_t *dev)
+{
+    dev->next = p->devices;
+    p->devices = dev;
+}
+
+/**
+ * !@brief Drive the pins of PORTA from outside, the edges go to IOCAF
+ */
+void pic_set_pins(pic14e_t *p, unsigned char mask, unsigned char level)
+{
+    unsigned char old = p->pins;
+
+    p->pins = (p->pins & ~mask) | (level ? mask : 0);
+    REG(PIC_IOCAF) |= ((old & ~p->pins & REG(PIC_IOCAN)) |
+                       (~old & p->pins & REG(PIC_IOCAP))) & 0x3f;
+}
+
+/**
+ * !@brief Run until the time
+ *
+ * An interrupt is taken 3 cycles after the instruction, the instruction
+ * after SLEEP runs before it. Sleep skips to the WDT or an interrupt flag.
+ * @return 0: reached, 1: sleeping at the time, -1: error
+ */
+int pic_run(pic14e_t *p, unsigned long long until)
+{
+    int cycles;
+
+    while (p->time < until) {
+        if (p->sleeping) {
+            if (irq(p)) {
+                p->sleeping = 0;
+                p->skip_irq = 1;
+            } else if ((REG(PIC_WDTCON) & 1) && p->wdt_at <= until) {
+                if (p->time < p->wdt_at) {
+                    p->time = p->wdt_at;
+                }
+                p->sleeping = 0;
+                REG(PIC_STATUS) &= ~ST_nTO;
+            } else {
+                p->time = until;
+                return 1;
+            }
+            continue;
+        }
+        if (!p->skip_irq && (REG(PIC_INTCON) & IC_GIE) && irq(p)) {
+            if (push(p, p->pc) < 0) {
+                return -1;
+            }
+            p->shadow[0] = REG(PIC_STATUS);
+            p->shadow[1] = W;
+            p->shadow[2] = REG(PIC_BSR);
+            p->shadow[3] = REG(PIC_PCLATH);
+            memcpy(&p->shadow[4], &REG(PIC_FSR0L), 4);
+            REG(PIC_INTCON) &= ~IC_GIE;
+            p->pc = PIC_VECTOR;
+            tick(p, 3);
+            if (p->on_interrupt) {
+                p->on_interrupt(p);
+            }
+            continue;
+        }
+        p->skip_irq = 0;
+        cycles = step(p);
+        if (cycles < 0) {
+            return -1;
+        }
+        tick(p, cycles);
+    }
+    return p->sleeping;
+}
+
+/**
+ * !@brief Read the data memory without side effects
+ */
+unsigned char pic_peek(pic14e_t *p, unsigned short addr)
+{
+    return p->data[addr % PIC_DATA_SIZE];
+}
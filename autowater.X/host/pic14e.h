@@ -0,0 +1,120 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Instruction-set simulator of the enhanced mid-range core (PIC14E)
+//  - Runs the production hex of XC8 for PIC12F1822 cycle by cycle:
+//    49 instructions, 16-level stack, shadow registers, FSR access to
+//    the linear data memory and to the program memory.
+//  - Peripherals are stubs enough for the firmware: Timer0, IOC of PORTA,
+//    MSSP in I2C master mode (timed by SSP1ADD) and the WDT wake up.
+//    Other SFRs are plain bytes.
+//  - I2C slaves are attached like hal_i2c_device_t of hal_host.h.
+//  - Hooks on call, return and interrupt let the caller profile cycles.
+
+#ifndef _PIC14E_H_
+#define _PIC14E_H_
+
+#define PIC_PROG_WORDS    2048        // PIC12F1822
+#define PIC_DATA_SIZE     (32 * 128)  // 32 banks
+#define PIC_STACK         16
+#define PIC_FOSC          8000000UL   // INTOSC 8MHz of init()
+#define PIC_TCY_NS        (4000000000UL / PIC_FOSC)
+#define PIC_VECTOR        0x0004      // interrupt vector
+
+// SFR (bank * 128 + offset)
+#define PIC_INDF0         0x000
+#define PIC_INDF1         0x001
+#define PIC_PCL           0x002
+#define PIC_STATUS        0x003
+#define PIC_FSR0L         0x004
+#define PIC_FSR1L         0x006
+#define PIC_BSR           0x008
+#define PIC_WREG          0x009
+#define PIC_PCLATH        0x00A
+#define PIC_INTCON        0x00B
+#define PIC_PORTA         0x00C
+#define PIC_PIR1          0x011
+#define PIC_PIR2          0x012
+#define PIC_TMR0          0x015
+#define PIC_TRISA         0x08C
+#define PIC_PIE1          0x091
+#define PIC_PIE2          0x092
+#define PIC_OPTION_REG    0x095
+#define PIC_WDTCON        0x097
+#define PIC_LATA          0x10C
+#define PIC_SSP1BUF       0x211
+#define PIC_SSP1ADD       0x212
+#define PIC_SSP1STAT      0x214
+#define PIC_SSP1CON2      0x216
+#define PIC_IOCAP         0x391
+#define PIC_IOCAN         0x392
+#define PIC_IOCAF         0x393
+
+/**
+ * I2C slave on the MSSP
+ */
+typedef struct pic_i2c_device {
+    unsigned char addr;                             // 7bit slave address
+    void (*start)(struct pic_i2c_device *dev, unsigned char rw);
+    unsigned char (*write)(struct pic_i2c_device *dev, unsigned char dt); // return 0:ACK 1:NACK
+    unsigned char (*read)(struct pic_i2c_device *dev);
+    void (*stop)(struct pic_i2c_device *dev);
+    struct pic_i2c_device *next;
+} pic_i2c_device_t;
+
+typedef struct pic14e {
+    unsigned short prog[PIC_PROG_WORDS];
+    unsigned char data[PIC_DATA_SIZE];
+    unsigned short pc;
+    unsigned short stack[PIC_STACK];
+    unsigned char sp;                   // levels used
+    unsigned char shadow[8];            // STATUS, WREG, BSR, PCLATH, FSR0L/H, FSR1L/H
+    unsigned long long cycles;          // instruction cycles executed
+    unsigned long long time;            // Tcy since reset, sleep included
+    int sleeping;
+    int skip_irq;                       // the instruction after SLEEP runs first
+    unsigned char pins;                 // levels driven on PORTA from outside
+    unsigned char last_pins;            // PORTA for the edges of IOC
+    unsigned short t0_prescaler;
+    unsigned char t0_inhibit;           // cycles of no count after a write of TMR0
+    unsigned char ssp_op;               // operation of MSSP in progress
+    unsigned long ssp_left;             // cycles to its end
+    unsigned char ssp_tx;               // byte being sent
+    unsigned char ssp_first;            // next byte is the address
+    unsigned long long wdt_at;          // time of the WDT wake up in sleep
+    pic_i2c_device_t *devices;
+    pic_i2c_device_t *selected;
+    void *user;
+    // hooks (may be NULL)
+    void (*on_call)(struct pic14e *p, unsigned short target);
+    void (*on_return)(struct pic14e *p);
+    void (*on_interrupt)(struct pic14e *p);
+} pic14e_t;
+
+void pic_reset(pic14e_t *p);
+int  pic_load_hex(pic14e_t *p, const char *path);
+void pic_i2c_attach(pic14e_t *p, pic_i2c_device_t *dev);
+void pic_set_pins(pic14e_t *p, unsigned char mask, unsigned char level);
+int  pic_run(pic14e_t *p, unsigned long long until);
+unsigned char pic_peek(pic14e_t *p, unsigned short addr);
+
+#endif
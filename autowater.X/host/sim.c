@@ -0,0 +1,1022 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Time-warp simulator
+//  - Runs the real init()/loop() of main.c on the virtual clock of
+//    hal_host.c with the RTC-8564NB and AQM0802A models attached.
+//  - __delay_ms() and SLEEP() advance the virtual time, so days of
+//    operation take seconds.
+//  - Buttons are driven by a scenario file (see scenarios/*.txt).
+//  - Prints the trace of relay on/off and, with -v, screen contents,
+//    then wake counts, awake time and relay time per day.
+//    A relay pulse shorter than RELAY_OPERATE is a flash of the LED, not a pump.
+//  - Prints the time from reset to the first SLEEP (boot to ready).
+//  - Every LCD timing violation is printed. Exit status is 1 if any.
+//  - With -j, prints only one JSON line of the bus, interrupt and awake
+//    statistics from the 'mark' of the scenario to the end (benchmark).
+//  - Measures the latency from the fall of RTC /INT to the relay on and
+//    to the release of /INT (the alarm flag cleared by the firmware).
+//  - Measures the time from the wake up to the screen drawn (settled).
+//    Naps of delay_ms() (SLEEP with the WDT) are counted apart from wake ups.
+//  - With LATENCY_STATS of main.c, the time from every press to the screen
+//    changed is counted in the buckets of the firmware and printed with the
+//    histogram the firmware saved in EEPROM.
+//  - Frames sent by the EUSART (UART_TELEMETRY of uart.h) are printed.
+//  - The soil-moisture sensor (SOIL_SENSOR of soil.h) gives the level of the
+//    scenario with a little noise to AN3 while RA5 powers it, and every
+//    measurement is printed.
+//  - The supply voltage of the scenario gives the reading of FVR by the
+//    ADC (VDD_MONITOR of vdd.h), and every measurement is printed.
+//  - The valves on the expander (VALVE_ZONES of gpio_pcf8574.h) are printed
+//    when they change, with the time the pump ran with all of them closed.
+//  - INTOSC runs off by the error of the scenario, every trim of OSCTUNE
+//    (OSC_CALIBRATION of osccal.h) is printed with the remaining error.
+//  - With -p, the EUSART is bridged to a pseudo terminal whose name is
+//    printed first, and the virtual time is paced to the wall clock, so
+//    awtool (or any terminal) can talk to the firmware.
+//  - With -t <file>, writes the state timeline for the energy estimator.
+//    One line per span of the same MCU state, split at every day:
+//      <start[s]> <duration[s]> active|sleep <i2c busy[s]> <lcd on[s]> <relay on[s]>
+//      <pull-up LO [pin*s]> <floating [pin*s]> <sensor on [s]>
+//
+// Usage: sim [-v|-j] [-p] [-t timeline.txt] scenario.txt
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "frame.h"
+
+#define DAY_NS          (86400ULL * SIM_SEC_NS)
+#define SCREEN_SETTLE   (10ULL * 1000000ULL)    // 10ms without change
+#define RELAY_OPERATE   (10ULL * 1000000ULL)    // shorter pulses are LED flashes
+#define MAX_EVENTS      1024
+#define MAX_DAYS        400
+#define MAX_UART        32                      // bytes of a uart command
+#define PTY_POLL        (1000000ULL)            // 1ms
+#define SOIL_SETTLE     (1000000ULL)            // the sensor output rises in 1ms
+
+enum { EV_PIN, EV_RTC, EV_MARK, EV_END, EV_UART, EV_SOIL, EV_VDD, EV_OSC, EV_LFOSC };
+
+typedef struct {
+    unsigned long long time;
+    unsigned char type;
+    unsigned char mask;
+    unsigned char level;
+    unsigned char tm[7];
+    unsigned char len;
+    unsigned char data[MAX_UART];
+    unsigned short soil;
+    unsigned short vdd;
+    long osc;
+} sim_event_t;
+
+typedef struct {
+    unsigned long wakeups;
+    unsigned long long sleep_ns;
+    unsigned long relay_count;
+    unsigned long long relay_ns;
+} sim_day_t;
+
+void firmware_main(void);
+
+static sim_rtc_t rtc;
+static sim_lcd_t lcd;
+static sim_gpio_t gpio;
+static sim_event_t events[MAX_EVENTS];
+static int event_count;
+static int event_pos;
+static hal_model_t script_model;
+static hal_model_t screen_model;
+static hal_model_t day_model;
+static unsigned long long screen_changed_at = HAL_NEVER;
+static char screen[2][9];
+static int verbose;
+static int json;
+static hal_stats_t mark_stats;
+static unsigned long long mark_time;
+static unsigned char relay;
+static unsigned long long relay_on_at;
+static unsigned long lcd_violations;
+static sim_day_t days[MAX_DAYS];
+static FILE *timeline;
+static unsigned long long span_start;       // current span of timeline
+static unsigned long long span_last;
+static unsigned long long span_i2c_ns;
+static unsigned long long span_lcd_ns;
+static unsigned long long span_relay_ns;
+static unsigned long long span_pullup_ns;   // [pin*ns]
+static unsigned long long span_float_ns;    // [pin*ns]
+static unsigned long long span_sensor_ns;
+static int pullup_pins;                     // pins leaking since last update
+static int float_pins;
+static int span_sleeping;
+static unsigned char rtc_int = 1;
+static unsigned long long alarm_at = HAL_NEVER;  // /INT fell, relay not yet on
+static unsigned long long alarm_int_at = HAL_NEVER; // /INT fell, not released
+static unsigned long alarm_count;
+static unsigned long long alarm_relay_max;
+static unsigned long long alarm_relay_sum;
+static unsigned long long alarm_clear_max;
+static int was_sleeping;
+static unsigned long long first_sleep_at = HAL_NEVER;
+static unsigned long long wake_at = HAL_NEVER;  // woke up, screen not drawn
+static unsigned long wake_count;
+static unsigned long long wake_screen_max;
+static unsigned long long wake_screen_sum;
+#ifdef LATENCY_STATS
+#define LATENCY_BUCKETS 7
+#define EE_LATENCY      16
+static unsigned long long press_at = HAL_NEVER; // pressed, screen not changed
+static unsigned long press_hist[LATENCY_BUCKETS];
+#endif
+static frame_t tx_frame;                    // frame being sent by the firmware
+static hal_model_t pty_model;
+static int use_pty;
+static int pty_fd = -1;
+static int pty_slave = -1;
+static unsigned long long pty_next;
+static struct timespec pty_start;
+static unsigned short soil_level = 400;     // AN3 while powered (0-1023)
+static unsigned long soil_noise = 1;        // LCG
+static unsigned long long soil_on_at = HAL_NEVER;
+static unsigned long soil_count;
+static unsigned long long soil_on_max;
+static unsigned long long soil_on_ns;
+#ifdef SOIL_SENSOR
+static unsigned long soil_conversions;      // at power on
+#endif
+static unsigned short vdd_mv = 3300;        // supply voltage [mV]
+static unsigned char vdd_fvr;               // FVR was on
+static unsigned long vdd_count;
+static unsigned char osctune;               // last OSCTUNE
+#ifdef VALVE_ZONES
+static unsigned char valves = 0xff;         // last port of the expander
+static unsigned long long dry_at = HAL_NEVER;   // pump on, all valves closed
+static unsigned long long dry_max;
+static unsigned long long dry_ns;
+#endif
+
+/**
+ * !@brief Print virtual time like "1+06:59:30.000"
+ */
+static void print_time(unsigned long long ns)
+{
+    unsigned long long ms = ns / 1000000ULL;
+    printf("%llu+%02llu:%02llu:%02llu.%03llu ", ms / 86400000ULL,
+           (ms / 3600000ULL) % 24, (ms / 60000ULL) % 60, (ms / 1000ULL) % 60,
+           ms % 1000);
+}
+
+static sim_day_t *day_at(unsigned long long ns)
+{
+    unsigned long long d = ns / DAY_NS;
+    return &days[d < MAX_DAYS ? d : MAX_DAYS - 1];
+}
+
+/**
+ * !@brief Add relay on time to the days it spans
+ */
+static void add_relay_time(unsigned long long from, unsigned long long to)
+{
+    while (from < to) {
+        unsigned long long end = (from / DAY_NS + 1) * DAY_NS;
+        if (end > to) {
+            end = to;
+        }
+        day_at(from)->relay_ns += end - from;
+        from = end;
+    }
+}
+
+/**
+ * !@brief Accumulate the states of the timeline until now
+ *
+ * @param[in] split Write the span even if the MCU state doesn't change
+ */
+static void timeline_update(int split)
+{
+    unsigned long long dt = hal_time_ns - span_last;
+
+    if (timeline == NULL) {
+        return;
+    }
+    span_last = hal_time_ns;
+    if (sim_lcd_powered(&lcd)) {
+        span_lcd_ns += dt;
+    }
+    if (relay) {
+        span_relay_ns += dt;
+    }
+    span_pullup_ns += dt * pullup_pins;
+    span_float_ns += dt * float_pins;
+    if (soil_on_at != HAL_NEVER) {
+        span_sensor_ns += dt;
+    }
+    if ((split || hal_is_sleeping() != span_sleeping) && hal_time_ns > span_start) {
+        fprintf(timeline, "%.6f %.6f %s %.6f %.6f %.6f %.6f %.6f %.6f\n", span_start / 1e9,
+                (hal_time_ns - span_start) / 1e9, span_sleeping ? "sleep" : "active",
+                (hal_stats.i2c_busy_ns - span_i2c_ns) / 1e9, span_lcd_ns / 1e9,
+                span_relay_ns / 1e9, span_pullup_ns / 1e9, span_float_ns / 1e9,
+                span_sensor_ns / 1e9);
+        span_start = hal_time_ns;
+        span_i2c_ns = hal_stats.i2c_busy_ns;
+        span_lcd_ns = 0;
+        span_relay_ns = 0;
+        span_pullup_ns = 0;
+        span_float_ns = 0;
+        span_sensor_ns = 0;
+    }
+    span_sleeping = hal_is_sleeping();
+    pullup_pins = __builtin_popcount(hal_pullup_lo());
+    float_pins = __builtin_popcount(hal_floating());
+}
+
+/**
+ * !@brief Power of the soil-moisture sensor (SOIL_SENSOR)
+ */
+static void soil_watch(void)
+{
+#ifdef SOIL_SENSOR
+    int on = (PORTA & ~TRISA & SOIL_POWER_BIT) != 0;
+
+    if (on && soil_on_at == HAL_NEVER) {
+        soil_on_at = hal_time_ns;
+        soil_conversions = hal_stats.adc_conversions;
+    } else if (!on && soil_on_at != HAL_NEVER) {
+        unsigned long long d = hal_time_ns - soil_on_at;
+        soil_count++;
+        soil_on_ns += d;
+        if (d > soil_on_max) {
+            soil_on_max = d;
+        }
+        soil_on_at = HAL_NEVER;
+        if (!json) {
+            print_time(hal_time_ns);
+            printf("soil sensor %.3f ms, %lu conversions, level %u\n", d / 1e6,
+                   hal_stats.adc_conversions - soil_conversions, soil_level);
+        }
+    }
+#endif
+}
+
+/**
+ * !@brief FVR turned on and off by the supply monitor (VDD_MONITOR)
+ */
+static void vdd_watch(void)
+{
+    if (FVRCONbits.FVREN && !vdd_fvr) {
+        vdd_count++;
+        if (!json) {
+            print_time(hal_time_ns);
+            printf("vdd %u mV, reading %u\n", vdd_mv, 1023U * 1024U / vdd_mv);
+        }
+    }
+    vdd_fvr = FVRCONbits.FVREN;
+}
+
+/**
+ * !@brief Valves on the expander and the pump (VALVE_ZONES)
+ */
+static void valve_watch(void)
+{
+#ifdef VALVE_ZONES
+    int dry = (PORTA & SIM_RELAY) && (gpio.port & ((1 << VALVE_ZONES) - 1)) == ((1 << VALVE_ZONES) - 1);
+
+    if (gpio.port != valves) {
+        valves = gpio.port;
+        if (!json) {
+            print_time(hal_time_ns);
+            printf("valves %02x", valves);
+            for (int i=0; i<VALVE_ZONES; i++) {
+                if ((valves & (1 << i)) == 0) {
+                    printf(" zone %d", i + 1);
+                }
+            }
+            printf("\n");
+        }
+    }
+    if (dry && dry_at == HAL_NEVER) {
+        dry_at = hal_time_ns;
+    } else if (!dry && dry_at != HAL_NEVER) {
+        if ((PORTA & SIM_RELAY) == 0 && hal_time_ns - relay_on_at < RELAY_OPERATE) {
+            dry_at = HAL_NEVER;         // a flash of the LED
+            return;
+        }
+        dry_ns += hal_time_ns - dry_at;
+        if (hal_time_ns - dry_at > dry_max) {
+            dry_max = hal_time_ns - dry_at;
+        }
+        dry_at = HAL_NEVER;
+    }
+#endif
+}
+
+/**
+ * !@brief Trim of INTOSC (OSC_CALIBRATION)
+ */
+static void osc_watch(void)
+{
+    if (OSCTUNE != osctune) {
+        osctune = OSCTUNE;
+        if (!json) {
+            print_time(hal_time_ns);
+            printf("osctune %d, INTOSC %+ld ppm\n", (osctune & 0x20) ? osctune - 64 : osctune,
+                   hal_osc_error());
+        }
+    }
+}
+
+/**
+ * !@brief Analog input of the ADC: the sensor on AN3 while it is powered,
+ *         FVR (1.024V) against the supply
+ */
+static unsigned short adc_in(unsigned char ch)
+{
+    unsigned long long v;
+
+    if (ch == 31 && FVRCONbits.FVREN) {
+        v = 1023U * 1024U / vdd_mv;
+        return (v > 1023) ? 1023 : (unsigned short)v;
+    }
+    if (ch != 3 || soil_on_at == HAL_NEVER) {
+        return 0;
+    }
+    v = soil_level;
+    if (hal_time_ns - soil_on_at < SOIL_SETTLE) {
+        v = v * (hal_time_ns - soil_on_at) / SOIL_SETTLE;
+    }
+    soil_noise = soil_noise * 1103515245UL + 12345UL;
+    v += (soil_noise >> 16) % 9;        // +0..8 LSB
+    v = (v > 4) ? v - 4 : 0;            // -4..+4 LSB
+    return (v > 1023) ? 1023 : (unsigned short)v;
+}
+
+/**
+ * !@brief Called by hal_host.c whenever pins are updated
+ */
+static void watch(void)
+{
+    unsigned char r = (PORTA & SIM_RELAY) != 0;
+    unsigned char i = (PORTA & SIM_RTCINT) != 0;
+
+    timeline_update(0);
+    soil_watch();
+    vdd_watch();
+    osc_watch();
+    valve_watch();
+
+    if (was_sleeping && !hal_is_sleeping()) {
+        wake_at = hal_time_ns;
+    }
+    if (hal_is_sleeping() && !SWDTEN && first_sleep_at == HAL_NEVER) {
+        first_sleep_at = hal_time_ns;
+    }
+    was_sleeping = hal_is_sleeping() && !SWDTEN;    // not a nap in delay_ms()
+
+    if (i != rtc_int) {
+        rtc_int = i;
+        if (i == 0) {
+            alarm_int_at = hal_time_ns;
+            if (!relay && (rtc.reg[1] & 0x08)) {    // AF, not the timer
+                alarm_at = hal_time_ns;
+            }
+        } else if (alarm_int_at != HAL_NEVER) {
+            if (hal_time_ns - alarm_int_at > alarm_clear_max) {
+                alarm_clear_max = hal_time_ns - alarm_int_at;
+            }
+            alarm_int_at = HAL_NEVER;
+        }
+    }
+
+    if (r != relay) {
+        relay = r;
+        if (!json) {
+            print_time(hal_time_ns);
+            printf("relay %s%s\n", r ? "on" : "off",
+                   (!r && hal_time_ns - relay_on_at < RELAY_OPERATE) ? " (flash)" : "");
+        }
+        if (r) {
+            relay_on_at = hal_time_ns;
+            if (alarm_at != HAL_NEVER) {
+                unsigned long long lat = hal_time_ns - alarm_at;
+                alarm_count++;
+                alarm_relay_sum += lat;
+                if (lat > alarm_relay_max) {
+                    alarm_relay_max = lat;
+                }
+                alarm_at = HAL_NEVER;
+            }
+        } else if (hal_time_ns - relay_on_at >= RELAY_OPERATE) {
+            day_at(relay_on_at)->relay_count++;
+            add_relay_time(relay_on_at, hal_time_ns);
+        }
+    }
+    if (lcd.violations != lcd_violations && !json) {
+        lcd_violations = lcd.violations;
+        print_time(lcd.v_time);
+        printf("lcd timing violation: %s %02Xh %.1fus early, %s %02Xh is executing\n",
+               lcd.v_rs ? "data" : "instruction", lcd.v_byte, lcd.v_early_ns / 1e3,
+               lcd.v_busy_rs ? "data" : "instruction", lcd.v_busy_byte);
+    }
+    if (lcd.changed) {
+        lcd.changed = 0;
+        screen_changed_at = hal_time_ns;
+    }
+}
+
+/**
+ * !@brief Print the screen after it settled
+ */
+static unsigned long long screen_next_event(hal_model_t *m)
+{
+    return (screen_changed_at == HAL_NEVER) ? HAL_NEVER : screen_changed_at + SCREEN_SETTLE;
+}
+
+static void screen_run(hal_model_t *m)
+{
+    char line[2][9];
+    unsigned long long drawn_at = screen_changed_at;
+
+    screen_changed_at = HAL_NEVER;
+    lcd.changed = 1;
+    sim_lcd_screen(&lcd, line);
+    if (wake_at != HAL_NEVER && strspn(line[0], " ") < 8 && drawn_at >= wake_at) {
+        unsigned long long lat = drawn_at - wake_at;
+        wake_count++;
+        wake_screen_sum += lat;
+        if (lat > wake_screen_max) {
+            wake_screen_max = lat;
+        }
+        wake_at = HAL_NEVER;
+    }
+    if (memcmp(line, screen, sizeof(screen)) != 0) {
+        memcpy(screen, line, sizeof(screen));
+#ifdef LATENCY_STATS
+        if (press_at != HAL_NEVER && strspn(line[0], " ") < 8 && drawn_at >= press_at) {
+            unsigned long long t = (drawn_at - press_at) / 128000 >> 7;  // like the firmware
+            int b;
+            for (b = 0; t != 0 && b < LATENCY_BUCKETS - 1; b++) {
+                t >>= 1;
+            }
+            press_hist[b]++;
+            press_at = HAL_NEVER;
+        }
+#endif
+        if (verbose && !json) {
+            print_time(hal_time_ns);
+            printf("lcd [%s] [%s]\n", screen[0], screen[1]);
+        }
+    }
+}
+
+/**
+ * !@brief Called by hal_host.c for every byte sent by the EUSART
+ */
+static void uart_out(unsigned char dt)
+{
+    char text[160];
+    int r;
+
+    if (pty_fd >= 0 && write(pty_fd, &dt, 1) != 1) {
+        // nobody reads the terminal, the byte is lost like on the wire
+    }
+    r = frame_feed(&tx_frame, dt);
+    if (r != 0 && !json) {
+        frame_string(&tx_frame, text, sizeof(text));
+        print_time(hal_time_ns);
+        printf("uart %s%s\n", text, (r < 0) ? " (bad checksum)" : "");
+    }
+}
+
+/**
+ * !@brief Bridge the EUSART to the pseudo terminal on the wall clock
+ */
+static int pty_open(void)
+{
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    struct termios tio;
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        perror("pty");
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    // Keep the terminal raw (no echo of the frames sent) while nobody opens it
+    pty_slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (pty_slave < 0 || tcgetattr(pty_slave, &tio) != 0) {
+        perror("pty");
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(pty_slave, TCSANOW, &tio);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    printf("pty %s\n", ptsname(fd));
+    clock_gettime(CLOCK_MONOTONIC, &pty_start);
+    return fd;
+}
+
+static unsigned long long pty_next_event(hal_model_t *m)
+{
+    return pty_next;
+}
+
+static void pty_run(hal_model_t *m)
+{
+    unsigned char buf[64];
+    struct timespec now;
+    long long ahead;
+    ssize_t n;
+
+    pty_next += PTY_POLL;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ahead = (long long)hal_time_ns - ((now.tv_sec - pty_start.tv_sec) * (long long)SIM_SEC_NS +
+                                      (now.tv_nsec - pty_start.tv_nsec));
+    if (ahead > 0) {
+        struct timespec d = {ahead / SIM_SEC_NS, ahead % SIM_SEC_NS};
+        nanosleep(&d, NULL);
+    }
+    n = read(pty_fd, buf, sizeof(buf));
+    for (ssize_t i=0; i<n; i++) {
+        hal_uart_rx(buf[i]);
+    }
+}
+
+/**
+ * !@brief Play the scenario events
+ */
+static unsigned long long script_next_event(hal_model_t *m)
+{
+    return (event_pos < event_count) ? events[event_pos].time : HAL_NEVER;
+}
+
+static void script_run(hal_model_t *m)
+{
+    while (event_pos < event_count && events[event_pos].time <= hal_time_ns) {
+        sim_event_t *ev = &events[event_pos++];
+        if (ev->type == EV_PIN) {
+            hal_set_pin(ev->mask, ev->level);
+#ifdef LATENCY_STATS
+            if (ev->level == 0 && press_at == HAL_NEVER) {
+                press_at = hal_time_ns;
+            }
+#endif
+        } else if (ev->type == EV_RTC) {
+            sim_rtc_set_time(&rtc, ev->tm);
+        } else if (ev->type == EV_SOIL) {
+            soil_level = ev->soil;
+        } else if (ev->type == EV_VDD) {
+            vdd_mv = ev->vdd;
+        } else if (ev->type == EV_OSC) {
+            hal_osc_ppm = ev->osc;
+        } else if (ev->type == EV_LFOSC) {
+            hal_lfosc_ppm = ev->osc;
+        } else if (ev->type == EV_UART) {
+            for (int i=0; i<ev->len; i++) {
+                hal_uart_rx(ev->data[i]);
+            }
+        } else if (ev->type == EV_MARK) {
+            mark_stats = hal_stats;
+            mark_time = hal_time_ns;
+            alarm_count = 0;
+            alarm_relay_sum = alarm_relay_max = alarm_clear_max = 0;
+            wake_count = 0;
+            wake_screen_sum = wake_screen_max = 0;
+        }
+    }
+}
+
+/**
+ * !@brief Parse time like "90s", "1500ms", "1d2h", "+200ms"
+ *
+ * @param[in] base Time of previous event for '+'
+ * @return Time [ns] or HAL_NEVER on error
+ */
+static unsigned long long parse_time(const char *s, unsigned long long base)
+{
+    unsigned long long t = 0;
+    char *end;
+
+    if (*s == '+') {
+        t = base;
+        s++;
+    }
+    while (*s) {
+        double v = strtod(s, &end);
+        unsigned long long unit = SIM_SEC_NS;
+        if (end == s) {
+            return HAL_NEVER;
+        }
+        s = end;
+        if (strncmp(s, "ms", 2) == 0) {
+            unit = 1000000ULL;
+            s += 2;
+        } else if (*s == 's' || *s == 'm' || *s == 'h' || *s == 'd') {
+            unit = (*s == 'm') ? 60 * SIM_SEC_NS : (*s == 'h') ? 3600 * SIM_SEC_NS :
+                   (*s == 'd') ? DAY_NS : SIM_SEC_NS;
+            s++;
+        }
+        t += (unsigned long long)(v * unit);
+    }
+    return t;
+}
+
+static sim_event_t *add_event(unsigned long long time, unsigned char type)
+{
+    sim_event_t *ev;
+    int i;
+
+    if (event_count >= MAX_EVENTS) {
+        fprintf(stderr, "too many events\n");
+        exit(1);
+    }
+    // keep sorted by time, stable for the same time
+    for (i = event_count; i > 0 && events[i - 1].time > time; i--) {
+        events[i] = events[i - 1];
+    }
+    ev = &events[i];
+    memset(ev, 0, sizeof(*ev));
+    ev->time = time;
+    ev->type = type;
+    event_count++;
+    return ev;
+}
+
+/**
+ * !@brief Load the scenario
+ *
+ * Each line is "<time> <command> [args]". '#' starts a comment.
+ *   <time> press SW1|SW2 <duration> [<count> <period>]
+ *                                     push the button (count times)
+ *   <time> rtc YYYY-MM-DD hh:mm:ss    set the RTC (as kept by battery)
+ *   <time> uart <hex> ...             send bytes to RX of the EUSART
+ *   <time> soil <0-1023>              output of the soil sensor while powered
+ *   <time> vdd <mV>                   supply voltage (3300 at reset)
+ *   <time> osc <ppm>                  error of INTOSC without OSCTUNE (0 at reset)
+ *   <time> lfosc <ppm>                error of LFINTOSC, the clock of the WDT (0 at reset)
+ *   <time> mark                       start of the benchmark statistics
+ *   <time> end                        end of the simulation
+ * <time> beginning with '+' is relative to the previous line.
+ */
+static int load_scenario(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    char line[256], tstr[64], cmd[32], a1[64], a2[64], a3[64], a4[64];
+    unsigned long long t = 0, prev = 0;
+    int lineno = 0, n;
+
+    if (fp == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        char *hash = strchr(line, '#');
+        sim_event_t *ev;
+
+        lineno++;
+        if (hash) {
+            *hash = '\0';
+        }
+        n = sscanf(line, "%63s %31s %63s %63s %63s %63s", tstr, cmd, a1, a2, a3, a4);
+        if (n <= 0) {
+            continue;
+        }
+        t = (n >= 2) ? parse_time(tstr, prev) : HAL_NEVER;
+        if (t == HAL_NEVER) {
+            fprintf(stderr, "%s:%d: syntax error\n", path, lineno);
+            return -1;
+        }
+        if (strcmp(cmd, "press") == 0 && (n == 4 || n == 6)) {
+            unsigned char mask = (strcmp(a1, "SW1") == 0) ? SIM_SW1 :
+                                 (strcmp(a1, "SW2") == 0) ? SIM_SW2 : 0;
+            unsigned long long d = parse_time(a2, 0);
+            int count = (n == 6) ? atoi(a3) : 1;
+            unsigned long long period = (n == 6) ? parse_time(a4, 0) : 0;
+            if (mask == 0 || d == HAL_NEVER || count < 1 || period == HAL_NEVER) {
+                fprintf(stderr, "%s:%d: bad press\n", path, lineno);
+                return -1;
+            }
+            for (int i=0; i<count; i++, t += period) {
+                ev = add_event(t, EV_PIN);
+                ev->mask = mask;
+                ev->level = 0;
+                ev = add_event(t + d, EV_PIN);
+                ev->mask = mask;
+                ev->level = 1;
+            }
+            t -= period;
+        } else if (strcmp(cmd, "rtc") == 0 && n == 4) {
+            int y, mo, d, h, mi, s;
+            if (sscanf(a1, "%d-%d-%d", &y, &mo, &d) != 3 ||
+                sscanf(a2, "%d:%d:%d", &h, &mi, &s) != 3) {
+                fprintf(stderr, "%s:%d: bad rtc\n", path, lineno);
+                return -1;
+            }
+            ev = add_event(t, EV_RTC);
+            ev->tm[0] = s;
+            ev->tm[1] = mi;
+            ev->tm[2] = h;
+            ev->tm[3] = d;
+            ev->tm[5] = mo;
+            ev->tm[6] = y % 100;
+        } else if (strcmp(cmd, "uart") == 0 && n >= 3) {
+            char *p = strstr(line, "uart") + 4;
+            char *end;
+            ev = add_event(t, EV_UART);
+            while (ev->len < MAX_UART) {
+                unsigned long v = strtoul(p, &end, 16);
+                if (end == p || v > 0xff) {
+                    break;
+                }
+                ev->data[ev->len++] = v;
+                p = end;
+            }
+            if (strspn(p, " \t\r\n") != strlen(p)) {
+                fprintf(stderr, "%s:%d: bad uart\n", path, lineno);
+                return -1;
+            }
+        } else if (strcmp(cmd, "soil") == 0 && n == 3) {
+            char *end;
+            unsigned long v = strtoul(a1, &end, 0);
+            if (*end != '\0' || v > 1023) {
+                fprintf(stderr, "%s:%d: bad soil\n", path, lineno);
+                return -1;
+            }
+            ev = add_event(t, EV_SOIL);
+            ev->soil = v;
+        } else if (strcmp(cmd, "vdd") == 0 && n == 3) {
+            char *end;
+            unsigned long v = strtoul(a1, &end, 0);
+            if (*end != '\0' || v < 1800 || v > 5500) {
+                fprintf(stderr, "%s:%d: bad vdd\n", path, lineno);
+                return -1;
+            }
+            ev = add_event(t, EV_VDD);
+            ev->vdd = v;
+        } else if (strcmp(cmd, "osc") == 0 && n == 3) {
+            char *end;
+            long v = strtol(a1, &end, 0);
+            if (*end != '\0' || v < -100000 || v > 100000) {
+                fprintf(stderr, "%s:%d: bad osc\n", path, lineno);
+                return -1;
+            }
+            ev = add_event(t, EV_OSC);
+            ev->osc = v;
+        } else if (strcmp(cmd, "lfosc") == 0 && n == 3) {
+            char *end;
+            long v = strtol(a1, &end, 0);
+            if (*end != '\0' || v < -500000 || v > 1000000) {
+                fprintf(stderr, "%s:%d: bad lfosc\n", path, lineno);
+                return -1;
+            }
+            ev = add_event(t, EV_LFOSC);
+            ev->osc = v;
+        } else if (strcmp(cmd, "mark") == 0) {
+            add_event(t, EV_MARK);
+        } else if (strcmp(cmd, "end") == 0) {
+            add_event(t, EV_END);
+            hal_time_limit_ns = t;
+        } else {
+            fprintf(stderr, "%s:%d: unknown command\n", path, lineno);
+            return -1;
+        }
+        prev = t;
+    }
+    fclose(fp);
+    if (hal_time_limit_ns == HAL_NEVER) {
+        hal_time_limit_ns = t + 60 * SIM_SEC_NS;
+    }
+    return 0;
+}
+
+/**
+ * !@brief Close the per day statistics at the end of every day
+ */
+static unsigned long long next_day = DAY_NS;
+static unsigned long prev_wakeups;
+static unsigned long long prev_sleep_ns;
+
+static void close_day(sim_day_t *d)
+{
+    d->wakeups = hal_stats.wakeups - prev_wakeups;
+    d->sleep_ns = hal_stats.sleep_ns - prev_sleep_ns;
+    prev_wakeups = hal_stats.wakeups;
+    prev_sleep_ns = hal_stats.sleep_ns;
+}
+
+static unsigned long long day_next_event(hal_model_t *m)
+{
+    return next_day;
+}
+
+static void day_run(hal_model_t *m)
+{
+    timeline_update(1);
+    close_day(day_at(next_day - 1));
+    next_day += DAY_NS;
+}
+
+/**
+ * !@brief Print the statistics since 'mark' as one JSON line
+ */
+static void print_json(const char *path)
+{
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    int len = strcspn(name, ".");
+    unsigned long long elapsed = hal_time_ns - mark_time;
+
+    printf("{\"scenario\":\"%.*s\",\"seconds\":%.3f,"
+           "\"i2c_transactions\":%lu,\"i2c_bytes\":%lu,\"i2c_busy_ms\":%.3f,"
+           "\"isr_entries\":%lu,\"awake_ms\":%.3f,\"wakeups\":%lu,\"naps\":%lu,"
+           "\"lcd_violations\":%lu,\"alarm_relay_max_us\":%.1f,"
+           "\"alarm_clear_max_us\":%.1f,\"wake_screen_max_ms\":%.3f}\n",
+           len, name, elapsed / 1e9,
+           hal_stats.i2c_transactions - mark_stats.i2c_transactions,
+           hal_stats.i2c_bytes - mark_stats.i2c_bytes,
+           (hal_stats.i2c_busy_ns - mark_stats.i2c_busy_ns) / 1e6,
+           hal_stats.isr_count - mark_stats.isr_count,
+           (elapsed - (hal_stats.sleep_ns - mark_stats.sleep_ns)) / 1e6,
+           hal_stats.wakeups - mark_stats.wakeups,
+           hal_stats.naps - mark_stats.naps,
+           lcd.violations, alarm_relay_max / 1e3, alarm_clear_max / 1e3,
+           wake_screen_max / 1e6);
+}
+
+static void print_summary(void)
+{
+    unsigned long long ndays = (hal_time_ns + DAY_NS - 1) / DAY_NS;
+    sim_day_t total = {0, 0, 0, 0};
+
+    if (ndays > MAX_DAYS) {
+        ndays = MAX_DAYS;
+    }
+    printf("\n%-6s %8s %10s %8s %10s\n", "day", "wakeups", "awake[s]", "pumps", "pump[s]");
+    for (unsigned long long d = 0; d < ndays; d++) {
+        unsigned long long len = DAY_NS;
+        if (d == ndays - 1 && hal_time_ns % DAY_NS) {
+            len = hal_time_ns % DAY_NS;
+        }
+        printf("%-6llu %8lu %10.3f %8lu %10.3f\n", d, days[d].wakeups,
+               (len - days[d].sleep_ns) / 1e9, days[d].relay_count, days[d].relay_ns / 1e9);
+        total.wakeups += days[d].wakeups;
+        total.sleep_ns += days[d].sleep_ns;
+        total.relay_count += days[d].relay_count;
+        total.relay_ns += days[d].relay_ns;
+    }
+    printf("%-6s %8lu %10.3f %8lu %10.3f\n", "total", total.wakeups,
+           (hal_time_ns - total.sleep_ns) / 1e9, total.relay_count, total.relay_ns / 1e9);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = NULL;
+    clock_t wall;
+
+    for (int i=1; i<argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            json = 1;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            use_pty = 1;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            timeline = fopen(argv[++i], "w");
+            if (timeline == NULL) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [-v|-j] [-p] [-t timeline.txt] scenario.txt\n", argv[0]);
+        return 2;
+    }
+
+    memset(screen, ' ', sizeof(screen));
+    screen[0][8] = screen[1][8] = '\0';
+    hal_reset();
+    sim_rtc_init(&rtc);
+    sim_lcd_init(&lcd);
+    sim_gpio_init(&gpio);
+    if (load_scenario(path) != 0) {
+        return 1;
+    }
+    script_model.next_event = script_next_event;
+    script_model.run = script_run;
+    hal_model_attach(&script_model);
+    screen_model.next_event = screen_next_event;
+    screen_model.run = screen_run;
+    hal_model_attach(&screen_model);
+    day_model.next_event = day_next_event;
+    day_model.run = day_run;
+    hal_model_attach(&day_model);
+    hal_watch = watch;
+    hal_uart_out = uart_out;
+    hal_adc_in = adc_in;
+    if (use_pty) {
+        pty_fd = pty_open();
+        if (pty_fd < 0) {
+            return 1;
+        }
+        pty_model.next_event = pty_next_event;
+        pty_model.run = pty_run;
+        hal_model_attach(&pty_model);
+    }
+
+    wall = clock();
+    hal_run(firmware_main);
+    wall = clock() - wall;
+
+    if (relay) {
+        day_at(relay_on_at)->relay_count++;
+        add_relay_time(relay_on_at, hal_time_ns);
+    }
+    if (timeline) {
+        timeline_update(1);
+        fclose(timeline);
+    }
+    if (next_day - DAY_NS < hal_time_ns) {
+        close_day(day_at(next_day - DAY_NS));
+    }
+    if (json) {
+        print_json(path);
+        return lcd.violations ? 1 : 0;
+    }
+    print_summary();
+    if (alarm_count) {
+        printf("alarm latency: %lu alarms, relay on max %.3f ms avg %.3f ms, "
+               "flag cleared max %.3f ms\n", alarm_count, alarm_relay_max / 1e6,
+               alarm_relay_sum / 1e6 / alarm_count, alarm_clear_max / 1e6);
+    }
+    if (wake_count) {
+        printf("wake to screen: %lu wakeups, max %.3f ms avg %.3f ms\n", wake_count,
+               wake_screen_max / 1e6, wake_screen_sum / 1e6 / wake_count);
+    }
+#ifdef LATENCY_STATS
+    printf("press to screen  <16 <33 <66 <131 <262 <524 >524 ms\n  sim     ");
+    for (int i=0; i<LATENCY_BUCKETS; i++) {
+        printf(" %4lu", press_hist[i]);
+    }
+    printf("\n  EEPROM  ");
+    for (int i=0; i<LATENCY_BUCKETS; i++) {
+        printf(" %4u", eeprom_read(EE_LATENCY + i));
+    }
+    printf("\n");
+#endif
+    if (hal_stats.uart_tx_bytes || hal_stats.uart_rx_bytes || hal_stats.uart_overruns) {
+        printf("uart: %lu bytes sent, %lu received, %lu lost\n", hal_stats.uart_tx_bytes,
+               hal_stats.uart_rx_bytes, hal_stats.uart_overruns);
+    }
+    if (soil_count) {
+        printf("soil sensor: %lu measurements, on max %.3f ms, total %.3f ms\n", soil_count,
+               soil_on_max / 1e6, soil_on_ns / 1e6);
+    }
+#ifdef VALVE_ZONES
+    sim_gpio_update(&gpio);
+    printf("valves: %lu writes, open", gpio.writes);
+    for (int i=0; i<VALVE_ZONES; i++) {
+        printf(" %.3f", gpio.lo_ns[i] / 1e9);
+    }
+    printf(" s, pump with all closed max %.3f ms total %.3f ms\n", dry_max / 1e6, dry_ns / 1e6);
+#endif
+    if (hal_osc_error() != 0) {
+        printf("INTOSC: %+ld ppm at the end\n", hal_osc_error());
+    }
+    if (vdd_count) {
+        printf("vdd: %lu measurements\n", vdd_count);
+    }
+    if (first_sleep_at != HAL_NEVER) {
+        printf("boot to first sleep: %.3f s\n", first_sleep_at / 1e9);
+    }
+    printf("lcd timing violations: %lu\n", lcd.violations);
+    printf("virtual %.1f s in %.3f s wall\n", hal_time_ns / 1e9,
+           (double)wall / CLOCKS_PER_SEC);
+    return lcd.violations ? 1 : 0;
+}
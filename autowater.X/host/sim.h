@@ -0,0 +1,128 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Device models of the simulator
+//  - RTC-8564NB : registers, clock, alarm, timer and /INT pin
+//  - AQM0802A   : ST7032 controller, DDRAM/CGRAM and display state,
+//                 checks the execution time of every byte
+//  - PCF8574    : port of the expander, time each pin was driven LO
+// All are attached to the MSSP model of hal_host.c.
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include "hal_host.h"
+#include "uart.h"
+#include "soil.h"
+#include "gpio_pcf8574.h"
+
+#define SIM_SEC_NS      1000000000ULL
+
+// pins of main.c
+#define SIM_RELAY       (1<<0)      // RA0
+#if defined(UART_TELEMETRY) || defined(SOIL_SENSOR)
+#define SIM_SW2         0           // no switches
+#define SIM_SW1         0
+#define SIM_RTCINT      (1<<3)      // RA3 (RA4/RA5 are TX/RX or the sensor)
+#else
+#define SIM_SW2         (1<<3)      // RA3
+#define SIM_SW1         (1<<4)      // RA4
+#define SIM_RTCINT      (1<<5)      // RA5
+#endif
+
+/**
+ * RTC-8564NB
+ */
+typedef struct {
+    hal_i2c_device_t dev;
+    hal_model_t model;
+    unsigned char reg[16];
+    unsigned char ptr;              // register address
+    unsigned char addr_phase;       // next write is register address
+    unsigned long long next_sec;    // time of next second
+    unsigned long long next_timer;  // time of next timer count (4096Hz, 64Hz)
+    unsigned char timer_count;
+} sim_rtc_t;
+
+void sim_rtc_init(sim_rtc_t *rtc);
+void sim_rtc_set_time(sim_rtc_t *rtc, const unsigned char *tm);
+
+/**
+ * AQM0802A (ST7032)
+ */
+typedef struct {
+    hal_i2c_device_t dev;
+    unsigned char ddram[0x80];
+    unsigned char cgram[0x40];
+    unsigned char ac;               // address counter
+    unsigned char cgram_mode;       // ac points CGRAM
+    unsigned char control;          // 1: next byte is control byte
+    unsigned char co;               // Co of last control byte
+    unsigned char rs;               // RS of last control byte
+    unsigned char is;               // instruction table select
+    unsigned char display;          // D,C,B of display on/off
+    unsigned char entry;            // I/D,S of entry mode set
+    unsigned char function;         // function set
+    unsigned char power;            // power/icon/contrast (IS=1)
+    unsigned char follower;         // follower control (IS=1)
+    unsigned char contrast;         // contrast low bits (IS=1)
+    unsigned char changed;          // screen changed since last check
+    unsigned char osc;              // internal OSC frequency (IS=1)
+    unsigned long long stable_at;   // follower voltage is stable (or HAL_NEVER)
+    // timing checker
+    unsigned long long busy_until;  // end of execution of last byte
+    unsigned char busy_byte;        // last instruction (0x100: data) that
+    unsigned char busy_rs;          //  keeps the controller busy
+    unsigned long violations;       // bytes written while busy
+    unsigned long long v_time;      // last violation: time,
+    unsigned long long v_early_ns;  //  how early it was,
+    unsigned char v_byte, v_rs;     //  the byte written
+    unsigned char v_busy_byte;      //  and the byte still executing
+    unsigned char v_busy_rs;
+} sim_lcd_t;
+
+// Execution time of ST7032 (fosc=380kHz, VDD=3.3V)
+#define SIM_LCD_POWER_ON_NS     40000000ULL     // wait after power on
+#define SIM_LCD_EXEC_NS         26300ULL        // most instructions and data
+#define SIM_LCD_CLEAR_NS        1080000ULL      // clear display, return home
+#define SIM_LCD_FOLLOWER_NS     200000000ULL    // follower on (power stable)
+
+void sim_lcd_init(sim_lcd_t *lcd);
+int  sim_lcd_screen(sim_lcd_t *lcd, char line[2][9]);
+int  sim_lcd_powered(sim_lcd_t *lcd);
+int  sim_lcd_visible(sim_lcd_t *lcd);
+
+/**
+ * PCF8574
+ */
+typedef struct {
+    hal_i2c_device_t dev;
+    unsigned char port;             // P7-P0 (0xff after power on)
+    unsigned long writes;           // bytes written
+    unsigned long long since;       // time the port was written last
+    unsigned long long lo_ns[8];    // time each pin was LO
+} sim_gpio_t;
+
+void sim_gpio_init(sim_gpio_t *gpio);
+void sim_gpio_update(sim_gpio_t *gpio);
+
+#endif
@@ -0,0 +1,77 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// PCF8574 model
+//  - A written byte is the port P7-P0, a read returns it.
+//  - Accumulates the time each pin is LO (the valve is open).
+
+#include <stddef.h>
+#include "sim.h"
+
+#define GPIO_ADDR   0x20
+
+/**
+ * !@brief Accumulate the LO time of the pins until now
+ */
+void sim_gpio_update(sim_gpio_t *gpio)
+{
+    for (int i=0; i<8; i++) {
+        if ((gpio->port & (1 << i)) == 0) {
+            gpio->lo_ns[i] += hal_time_ns - gpio->since;
+        }
+    }
+    gpio->since = hal_time_ns;
+}
+
+static unsigned char pcf_write(hal_i2c_device_t *dev, unsigned char dt)
+{
+    sim_gpio_t *gpio = (sim_gpio_t *)dev;
+
+    sim_gpio_update(gpio);
+    gpio->port = dt;
+    gpio->writes++;
+    return 0;
+}
+
+static unsigned char pcf_read(hal_i2c_device_t *dev)
+{
+    return ((sim_gpio_t *)dev)->port;
+}
+
+/**
+ * !@brief Initialize PCF8574 model as power-on (all HI)
+ */
+void sim_gpio_init(sim_gpio_t *gpio)
+{
+    gpio->port = 0xff;
+    gpio->writes = 0;
+    gpio->since = hal_time_ns;
+    for (int i=0; i<8; i++) {
+        gpio->lo_ns[i] = 0;
+    }
+    gpio->dev.addr = GPIO_ADDR;
+    gpio->dev.start = NULL;
+    gpio->dev.write = pcf_write;
+    gpio->dev.read = pcf_read;
+    gpio->dev.stop = NULL;
+    hal_i2c_attach(&gpio->dev);
+}
@@ -0,0 +1,222 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// AQM0802A (ST7032) model
+//  - Control byte: Co(bit7) 1 means one data byte and another control
+//    byte follow, 0 means the rest are data. RS(bit6) selects data/command.
+//  - Instructions of table IS=0 and IS=1, DDRAM and CGRAM.
+//  - Line 1 is DDRAM 00h-07h and line 2 is DDRAM 40h-47h.
+//  - Timing checker: every instruction or data byte must arrive after the
+//    execution time of the previous one (and 40ms after power on).
+//    Violations are counted with the detail of the last one.
+
+#include <string.h>
+#include "sim.h"
+
+#define LCD_ADDR    0x3E
+
+static void lcd_instruction(sim_lcd_t *lcd, unsigned char c)
+{
+    if (c & 0x80) {                     // Set DDRAM address
+        lcd->ac = c & 0x7f;
+        lcd->cgram_mode = 0;
+    } else if (c & 0x40) {
+        if (lcd->is == 0) {             // Set CGRAM address
+            lcd->ac = c & 0x3f;
+            lcd->cgram_mode = 1;
+        } else if ((c & 0x30) == 0x10) {
+            lcd->power = c & 0x0f;      // Power/ICON/Contrast control
+            lcd->changed = 1;
+        } else if ((c & 0x30) == 0x20) {
+            lcd->follower = c & 0x0f;   // Follower control
+            lcd->stable_at = (c & 0x08) ? hal_time_ns + SIM_LCD_FOLLOWER_NS : HAL_NEVER;
+            lcd->changed = 1;
+        } else if ((c & 0x30) == 0x30) {
+            lcd->contrast = c & 0x0f;   // Contrast set
+        }
+    } else if (c & 0x20) {              // Function set
+        lcd->function = c & 0x1f;
+        lcd->is = c & 0x01;
+    } else if (c & 0x10) {
+        if (lcd->is) {
+            lcd->osc = c & 0x0f;        // Internal OSC frequency
+        }
+        // Cursor or display shift (IS=0) doesn't change the screen here
+    } else if (c & 0x08) {              // Display ON/OFF
+        lcd->display = c & 0x07;
+        lcd->changed = 1;
+    } else if (c & 0x04) {              // Entry mode set
+        lcd->entry = c & 0x03;
+    } else if (c & 0x02) {              // Return home
+        lcd->ac = 0;
+        lcd->cgram_mode = 0;
+    } else if (c & 0x01) {              // Clear display
+        memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+        lcd->ac = 0;
+        lcd->cgram_mode = 0;
+        lcd->entry |= 0x02;
+        lcd->changed = 1;
+    }
+}
+
+static void lcd_data(sim_lcd_t *lcd, unsigned char dt)
+{
+    if (lcd->cgram_mode) {
+        lcd->cgram[lcd->ac & 0x3f] = dt;
+    } else {
+        if (lcd->ddram[lcd->ac & 0x7f] != dt) {
+            lcd->changed = 1;
+        }
+        lcd->ddram[lcd->ac & 0x7f] = dt;
+    }
+    lcd->ac = (lcd->entry & 0x02) ? lcd->ac + 1 : lcd->ac - 1;
+}
+
+/**
+ * !@brief Execution time of the byte
+ */
+static unsigned long long lcd_exec_ns(sim_lcd_t *lcd, unsigned char rs, unsigned char c)
+{
+    if (rs) {
+        return SIM_LCD_EXEC_NS;
+    }
+    if (c == 0x01 || (c & 0xfe) == 0x02) {
+        return SIM_LCD_CLEAR_NS;        // Clear display, Return home
+    }
+    if (lcd->is && (c & 0xf8) == 0x68) {
+        return SIM_LCD_FOLLOWER_NS;     // Follower control (Fon=1)
+    }
+    return SIM_LCD_EXEC_NS;
+}
+
+/**
+ * !@brief Check the byte arrives after the last one was executed
+ */
+static void lcd_check_timing(sim_lcd_t *lcd, unsigned char rs, unsigned char c)
+{
+    if (hal_time_ns < lcd->busy_until) {
+        lcd->violations++;
+        lcd->v_time = hal_time_ns;
+        lcd->v_early_ns = lcd->busy_until - hal_time_ns;
+        lcd->v_byte = c;
+        lcd->v_rs = rs;
+        lcd->v_busy_byte = lcd->busy_byte;
+        lcd->v_busy_rs = lcd->busy_rs;
+    }
+    lcd->busy_until = hal_time_ns + lcd_exec_ns(lcd, rs, c);
+    lcd->busy_byte = c;
+    lcd->busy_rs = rs;
+}
+
+static void lcd_start(hal_i2c_device_t *dev, unsigned char rw)
+{
+    sim_lcd_t *lcd = (sim_lcd_t *)dev;
+    lcd->control = 1;
+}
+
+static unsigned char lcd_write(hal_i2c_device_t *dev, unsigned char dt)
+{
+    sim_lcd_t *lcd = (sim_lcd_t *)dev;
+
+    if (lcd->control) {
+        lcd->co = dt & 0x80;
+        lcd->rs = dt & 0x40;
+        lcd->control = 0;
+        return 0;
+    }
+    lcd_check_timing(lcd, lcd->rs, dt);
+    if (lcd->rs) {
+        lcd_data(lcd, dt);
+    } else {
+        lcd_instruction(lcd, dt);
+    }
+    if (lcd->co) {
+        lcd->control = 1;
+    }
+    return 0;
+}
+
+/**
+ * !@brief Initialize LCD model as power-on
+ */
+void sim_lcd_init(sim_lcd_t *lcd)
+{
+    memset(lcd, 0, sizeof(*lcd));
+    memset(lcd->ddram, ' ', sizeof(lcd->ddram));
+    lcd->entry = 0x02;
+    lcd->busy_until = hal_time_ns + SIM_LCD_POWER_ON_NS;
+    lcd->stable_at = HAL_NEVER;
+    lcd->dev.addr = LCD_ADDR;
+    lcd->dev.start = lcd_start;
+    lcd->dev.write = lcd_write;
+    lcd->dev.read = NULL;
+    lcd->dev.stop = NULL;
+    hal_i2c_attach(&lcd->dev);
+}
+
+/**
+ * !@brief Get the visible characters
+ *
+ * @param[out] line Two lines of 8 characters. Empty unless visible.
+ * @return 1 when screen changed since last call
+ */
+int sim_lcd_screen(sim_lcd_t *lcd, char line[2][9])
+{
+    int changed = lcd->changed;
+
+    for (int row=0; row<2; row++) {
+        for (int col=0; col<8; col++) {
+            unsigned char c = lcd->ddram[row * 0x40 + col];
+            if (!sim_lcd_visible(lcd)) {
+                c = ' ';
+            } else if (c < 0x20 || c >= 0x7f) {
+                c = '?';                // CGRAM or non ASCII
+            }
+            line[row][col] = c;
+        }
+        line[row][8] = '\0';
+    }
+    lcd->changed = 0;
+    return changed;
+}
+
+/**
+ * !@brief Whether the panel draws the operating current
+ *
+ * @return 1 when display, booster (Bon) or follower (Fon) is on
+ */
+int sim_lcd_powered(sim_lcd_t *lcd)
+{
+    return (lcd->display & 0x04) || (lcd->power & 0x04) || (lcd->follower & 0x08);
+}
+
+/**
+ * !@brief Whether the characters can be seen
+ *
+ * @return 1 when display, booster and follower are on and the voltage of
+ *         the follower is stable
+ */
+int sim_lcd_visible(sim_lcd_t *lcd)
+{
+    return (lcd->display & 0x04) && (lcd->power & 0x04) && (lcd->follower & 0x08) &&
+           hal_time_ns >= lcd->stable_at;
+}
@@ -0,0 +1,257 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// RTC-8564NB model
+//  - Registers 00h-0Fh with auto increment of the register address.
+//  - Clock counts in BCD every second unless STOP of Control1 is set.
+//  - Alarm sets AF when minute/hour/day/weekday of enabled registers match.
+//  - Timer counts down with the source of TD and sets TF.
+//  - /INT (SIM_RTCINT) is LO while (AF and AIE) or (TF and TIE).
+
+#include <stddef.h>
+#include "sim.h"
+
+#define RTC_ADDR    0x51
+
+#define CTRL1_STOP  0x20
+#define CTRL2_TIE   0x01
+#define CTRL2_AIE   0x02
+#define CTRL2_TF    0x04
+#define CTRL2_AF    0x08
+#define TIMER_TE    0x80
+
+static unsigned char bcd_inc(unsigned char *v, unsigned char mask, unsigned char first,
+                             unsigned char last)
+{
+    unsigned char n = (*v & mask);
+    n = (n >> 4) * 10 + (n & 0xf) + 1;
+    if (n > last) {
+        n = first;
+    }
+    *v = (*v & ~mask) | (((n / 10) << 4) | (n % 10));
+    return n == first;  // carry
+}
+
+static unsigned char bcd2num(unsigned char v)
+{
+    return (v >> 4) * 10 + (v & 0xf);
+}
+
+static unsigned char days_of_month(sim_rtc_t *rtc)
+{
+    static const unsigned char days[] = {31,28,31,30,31,30,31,31,30,31,30,31};
+    unsigned char month = bcd2num(rtc->reg[7] & 0x1f);
+    unsigned char year = bcd2num(rtc->reg[8]);
+
+    if (month == 2 && (year % 4) == 0) {
+        return 29;
+    }
+    return (1 <= month && month <= 12) ? days[month - 1] : 31;
+}
+
+static void rtc_update_int(sim_rtc_t *rtc)
+{
+    unsigned char c2 = rtc->reg[1];
+    int active = ((c2 & CTRL2_AF) && (c2 & CTRL2_AIE)) ||
+                 ((c2 & CTRL2_TF) && (c2 & CTRL2_TIE));
+    hal_set_pin(SIM_RTCINT, !active);
+}
+
+static void rtc_timer_count(sim_rtc_t *rtc)
+{
+    if (rtc->timer_count == 0 || --rtc->timer_count == 0) {
+        rtc->reg[1] |= CTRL2_TF;
+        rtc->timer_count = rtc->reg[15];
+    }
+}
+
+static void rtc_check_alarm(sim_rtc_t *rtc)
+{
+    static const unsigned char masks[] = {0x7f, 0x3f, 0x3f, 0x07};
+    int enabled = 0;
+
+    for (int i=0; i<4; i++) {
+        unsigned char a = rtc->reg[9 + i];
+        if (a & 0x80) {
+            continue;
+        }
+        enabled = 1;
+        if ((a & masks[i]) != (rtc->reg[3 + i] & masks[i])) {
+            return;
+        }
+    }
+    if (enabled) {
+        rtc->reg[1] |= CTRL2_AF;
+    }
+}
+
+/**
+ * !@brief Count one second
+ */
+static void rtc_tick(sim_rtc_t *rtc)
+{
+    unsigned char *r = rtc->reg;
+    unsigned char td = r[14] & 0x03;
+
+    if (bcd_inc(&r[2], 0x7f, 0, 59)) {
+        if (bcd_inc(&r[3], 0x7f, 0, 59) && bcd_inc(&r[4], 0x3f, 0, 23)) {
+            bcd_inc(&r[6], 0x07, 0, 6);
+            if (bcd_inc(&r[5], 0x3f, 1, days_of_month(rtc)) &&
+                bcd_inc(&r[7], 0x1f, 1, 12)) {
+                bcd_inc(&r[8], 0xff, 0, 99);
+            }
+        }
+        rtc_check_alarm(rtc);
+        if ((r[14] & TIMER_TE) && td == 3) {
+            rtc_timer_count(rtc);
+        }
+    }
+    if ((r[14] & TIMER_TE) && td == 2) {
+        rtc_timer_count(rtc);
+    }
+}
+
+static unsigned long long rtc_next_event(hal_model_t *m)
+{
+    sim_rtc_t *rtc = (sim_rtc_t *)((char *)m - offsetof(sim_rtc_t, model));
+    unsigned long long next = rtc->next_sec;
+
+    if (rtc->next_timer < next) {
+        next = rtc->next_timer;
+    }
+    return next;
+}
+
+static void rtc_run(hal_model_t *m)
+{
+    sim_rtc_t *rtc = (sim_rtc_t *)((char *)m - offsetof(sim_rtc_t, model));
+    unsigned char td = rtc->reg[14] & 0x03;
+
+    if (rtc->next_sec <= hal_time_ns) {
+        rtc->next_sec += SIM_SEC_NS;
+        rtc_tick(rtc);
+    }
+    if (rtc->next_timer <= hal_time_ns) {
+        rtc->next_timer += (td == 0) ? SIM_SEC_NS / 4096 : SIM_SEC_NS / 64;
+        rtc_timer_count(rtc);
+    }
+    rtc_update_int(rtc);
+}
+
+static void rtc_restart_timer(sim_rtc_t *rtc)
+{
+    unsigned char tc = rtc->reg[14];
+
+    rtc->timer_count = rtc->reg[15];
+    rtc->next_timer = HAL_NEVER;
+    if ((tc & TIMER_TE) && (tc & 0x03) < 2) {
+        rtc->next_timer = hal_time_ns + (((tc & 0x03) == 0) ? SIM_SEC_NS / 4096 : SIM_SEC_NS / 64);
+    }
+}
+
+static void rtc_start(hal_i2c_device_t *dev, unsigned char rw)
+{
+    sim_rtc_t *rtc = (sim_rtc_t *)dev;
+    rtc->addr_phase = (rw == 0);
+}
+
+static unsigned char rtc_write(hal_i2c_device_t *dev, unsigned char dt)
+{
+    sim_rtc_t *rtc = (sim_rtc_t *)dev;
+    unsigned char *r = rtc->reg;
+    unsigned char p = rtc->ptr;
+
+    if (rtc->addr_phase) {
+        rtc->addr_phase = 0;
+        rtc->ptr = dt & 0x0f;
+        return 0;
+    }
+    if (p == 0) {
+        if ((r[0] & CTRL1_STOP) && !(dt & CTRL1_STOP)) {
+            rtc->next_sec = hal_time_ns + SIM_SEC_NS;   // restart prescaler
+        }
+        r[0] = dt;
+        if (dt & CTRL1_STOP) {
+            rtc->next_sec = HAL_NEVER;
+        }
+    } else if (p == 1) {
+        // AF and TF can only be cleared
+        r[1] = (dt & 0x13) | (r[1] & dt & (CTRL2_AF|CTRL2_TF));
+        rtc_update_int(rtc);
+    } else {
+        r[p] = dt;
+        if (p == 14 || p == 15) {
+            rtc_restart_timer(rtc);
+        }
+    }
+    rtc->ptr = (p + 1) & 0x0f;
+    return 0;
+}
+
+static unsigned char rtc_read(hal_i2c_device_t *dev)
+{
+    sim_rtc_t *rtc = (sim_rtc_t *)dev;
+    unsigned char dt = rtc->reg[rtc->ptr];
+
+    rtc->ptr = (rtc->ptr + 1) & 0x0f;
+    return dt;
+}
+
+/**
+ * !@brief Initialize RTC model as power-on (VL is set)
+ */
+void sim_rtc_init(sim_rtc_t *rtc)
+{
+    for (int i=0; i<16; i++) {
+        rtc->reg[i] = 0;
+    }
+    rtc->reg[2] = 0x80;             // VL
+    rtc->reg[5] = 0x01;
+    rtc->reg[7] = 0x01;
+    rtc->reg[9] = rtc->reg[10] = rtc->reg[11] = rtc->reg[12] = 0x80;
+    rtc->ptr = 0;
+    rtc->addr_phase = 0;
+    rtc->next_sec = hal_time_ns + SIM_SEC_NS;
+    rtc->next_timer = HAL_NEVER;
+    rtc->timer_count = 0;
+    rtc->dev.addr = RTC_ADDR;
+    rtc->dev.start = rtc_start;
+    rtc->dev.write = rtc_write;
+    rtc->dev.read = rtc_read;
+    rtc->dev.stop = NULL;
+    rtc->model.next_event = rtc_next_event;
+    rtc->model.run = rtc_run;
+    hal_i2c_attach(&rtc->dev);
+    hal_model_attach(&rtc->model);
+}
+
+/**
+ * !@brief Set the time and clear VL, like the RTC kept running on battery
+ *
+ * @param[in] tm Same format as rtc_init() of rtc_8564nb.c (binary)
+ */
+void sim_rtc_set_time(sim_rtc_t *rtc, const unsigned char *tm)
+{
+    for (int i=0; i<7; i++) {
+        rtc->reg[2 + i] = ((tm[i] / 10) << 4) | (tm[i] % 10);
+    }
+}
@@ -25,23 +25,103 @@
  * - This codes use 8MHz for CPU clock.
  *   If you change clock, change SSP1ADD value.
  * - i2c speed is 100KHz
+ * - Every wait for the MSSP is bounded by I2C_WAIT_COUNT polls.
+ *   When it runs out, the bus is recovered and I2C_TIMEOUT is returned,
+ *   so a stuck SDA line or a missing device can't hang the firmware.
+ * - With I2C_PIPELINE the CPU works while a byte is on the bus:
+ *   i2c_send() returns as soon as the byte is in SSP1BUF and the ACK is
+ *   checked before the next operation (a NACK is returned by i2c_stop()),
+ *   i2c_receive(ACK) starts to receive the next byte before it returns.
+ * - With I2C_PRIORITY long transfers call i2c_yield() between bytes.
+ *   When the interrupt set i2c_urgent, the transfer is ended there,
+ *   i2c_urgent_proc() uses the bus and the transfer starts again.
  */
 
-#include <xc.h>
+#include "hal.h"
 #include "i2c.h"
 
-int ack_flag;
+#define SCL_BIT     (1<<1)  // RA1 is SCL
+#define SDA_BIT     (1<<2)  // RA2 is SDA
+
+volatile char ack_flag;     // 1 while waiting for ACK of the sent byte
+volatile char i2c_collision;// set by interrupt when bus collision occurred
+char i2c_error;             // error of current transaction (sticky)
+#ifdef I2C_PIPELINE
+char i2c_sent;              // 1 while ACK of the sent byte isn't checked
+char i2c_nack;              // NACK of the sent bytes (sticky)
+char i2c_prefetch;          // 1 while receiving the next byte
+#endif
+#ifdef I2C_PRIORITY
+volatile char i2c_urgent;   // set by interrupt when i2c_urgent_proc() waits
+#endif
+
+/**
+ * !@brief Recover the i2c bus
+ *
+ * Clock out up to 9 SCL pulses until the slave releases SDA,
+ * send the stop condition and re-initialize the MSSP.
+ * Lines are driven as open drain (LATA=0, pull-up by TRISA=1).
+ */
+void i2c_recover(void)
+{
+    SSP1CON1bits.SSPEN = 0;         // Release the pins from MSSP
+    LATA = LATA & ~(SCL_BIT|SDA_BIT);
+    for (char i=0; i<9; i++) {
+        if (PORTA & SDA_BIT) {
+            break;                  // Slave released SDA
+        }
+        TRISA = TRISA & ~SCL_BIT;   // SCL LO
+        __delay_us(5);
+        TRISA = TRISA | SCL_BIT;    // SCL HI
+        __delay_us(5);
+    }
+
+    // Stop condition: SDA LO -> HI while SCL is HI
+    TRISA = TRISA & ~SDA_BIT;       // SDA LO
+    __delay_us(5);
+    TRISA = TRISA | SDA_BIT;        // SDA HI
+    __delay_us(5);
+
+    ack_flag = 0;
+    i2c_collision = 0;
+    i2c_init_master();
+}
 
 /**
  * !@brief Check the idle status
  *
  * Escape this function when ACKEN, RCEN, PEN, RSEN, SEN, R/W and BF registers
- * were all zero.
+ * were all zero and ACK of the sent byte was received.
+ * Waiting is bounded by I2C_WAIT_COUNT polls. When it runs out or the bus
+ * collision was occurred, recover the bus and return I2C_TIMEOUT.
+ * Once the transaction failed, return I2C_TIMEOUT without waiting until
+ * i2c_stop.
+ * With I2C_PIPELINE, the ACK of the byte sent before is checked here.
  * @param[in] mask Mask for SSP1STAT register
+ * @return Return the result. 0:idle I2C_TIMEOUT:failure
  */
-void i2c_check_idle(char mask)
+char i2c_check_idle(char mask)
 {
-    while ((SSP1CON2 & 0x1F ) | (SSP1STAT & mask));
+    unsigned char count = I2C_WAIT_COUNT;
+
+    while (i2c_error == 0) {
+        HAL_POLL();
+        if (i2c_collision || --count == 0) {
+            i2c_recover();
+            i2c_error = I2C_TIMEOUT;
+            break;
+        }
+        if ((ack_flag | (SSP1CON2 & 0x1F) | (SSP1STAT & mask)) == 0) {
+            #ifdef I2C_PIPELINE
+            if (i2c_sent) {
+                i2c_sent = 0;
+                i2c_nack |= SSP1CON2bits.ACKSTAT;
+            }
+            #endif
+            break;
+        }
+    }
+    return i2c_error;
 }
 
 /**
@@ -58,7 +138,8 @@ void i2c_interrupt(void)
         SSP1IF = 0;
     }
     if (BCL1IF == 1) {
-        BCL1IF = 0;         // Clear only
+        BCL1IF = 0;
+        i2c_collision = 1;  // Recovered by i2c_check_idle
     }
 }
 
@@ -88,20 +169,18 @@ void i2c_init_master(void)
  *
  * @param[in] adrs Slave address
  * @param[in] rw 0:write 1:read
- * @return Return the result. 0:success 1:failure
+ * @return Return the result. 0:success 1:failure I2C_TIMEOUT:bus error
  */
 int i2c_start(int adrs, int rw)
 {
     // Set start condition
-    i2c_check_idle(0x5);
+    if (i2c_check_idle(0x5)) {
+        return I2C_TIMEOUT;
+    }
     SSP1CON2bits.SEN = 1;
 
     // Set slave address and rw mode
-    i2c_check_idle(0x5);
-    ack_flag = 1;
-    SSP1BUF = (char)((adrs<<1)+rw);
-    while (ack_flag);       // Wait ACK
-    return SSP1CON2bits.ACKSTAT;
+    return i2c_send_address((char)((adrs<<1)+rw));
 }
 
 /**
@@ -109,62 +188,170 @@ int i2c_start(int adrs, int rw)
  *
  * @param[in] adrs Slave address
  * @param[in] rw 0:write 1:read
- * @return Return the result. 0:success 1:failure
+ * @return Return the result. 0:success 1:failure I2C_TIMEOUT:bus error
  */
 int i2c_rstart(int adrs,int rw)
 {
     // Set repeated start condition
-    i2c_check_idle(0x5);
+    if (i2c_check_idle(0x5)) {
+        return I2C_TIMEOUT;
+    }
     SSP1CON2bits.RSEN = 1;
 
     // Set slave address and rw mode
-    i2c_check_idle(0x5);
-    ack_flag = 1;
-    SSP1BUF = (char)((adrs<<1)+rw);
-    while (ack_flag);       // Wait ACK
-    return SSP1CON2bits.ACKSTAT;
+    return i2c_send_address((char)((adrs<<1)+rw));
 }
 
 /**
  * !@brief Send stop condition
+ *
+ * When the transaction failed, the stop condition was already sent
+ * by i2c_recover(). The error of transaction is cleared here.
+ * @return Return the result of transaction. 0:success I2C_TIMEOUT:bus error
+ *         With I2C_PIPELINE, 1 when a sent byte was not acknowledged.
+ */
+int i2c_stop(void)
+{
+    char ret;
+
+    if (i2c_check_idle(0x5) == 0) {
+        SSP1CON2bits.PEN = 1;
+    }
+    ret = i2c_error;
+    i2c_error = 0;
+    #ifdef I2C_PIPELINE
+    ret |= i2c_nack;
+    i2c_nack = 0;
+    i2c_sent = 0;
+    i2c_prefetch = 0;
+    #endif
+    return ret;
+}
+
+/**
+ * !@brief Stop the MSSP before SLEEP()
+ *
+ * Wait for the stop condition, then release SCL/SDA as inputs (TRISA=1).
+ * The idle bus stays HI by the pull-ups and draws no current.
  */
-void i2c_stop(void)
+void i2c_sleep(void)
 {
     i2c_check_idle(0x5);
-    SSP1CON2bits.PEN = 1;
+    i2c_error = 0;
+    SSP1CON1bits.SSPEN = 0;
+}
+
+/**
+ * !@brief Restart the MSSP after SLEEP()
+ */
+void i2c_wake(void)
+{
+    SSP1CON1bits.SSPEN = 1;
 }
 
 /**
  * !@brief Send data
  *
+ * With I2C_PIPELINE, return without waiting the ACK. The NACK is returned
+ * by i2c_stop().
  * @param[in] dt Data to send
- * @return Return the result. 0:success 1:failure
+ * @return Return the result. 0:success 1:failure I2C_TIMEOUT:bus error
  */
 int i2c_send(char dt)
 {
-    i2c_check_idle(0x5);
+    if (i2c_check_idle(0x5)) {
+        return I2C_TIMEOUT;
+    }
     ack_flag = 1;
     SSP1BUF = dt;
-    while (ack_flag);       // Wait ACK
+    #ifdef I2C_PIPELINE
+    i2c_sent = 1;
+    return 0;
+    #else
+    if (i2c_check_idle(0x5)) {  // Wait ACK
+        return I2C_TIMEOUT;
+    }
+    return SSP1CON2bits.ACKSTAT;
+    #endif
+}
+
+#ifdef I2C_PIPELINE
+/**
+ * !@brief Send the slave address and wait the ACK
+ *
+ * Without I2C_PIPELINE, this is i2c_send() (see i2c.h).
+ * @param[in] dt Slave address and rw mode
+ * @return Return the result. 0:success 1:failure I2C_TIMEOUT:bus error
+ */
+int i2c_send_address(char dt)
+{
+    if (i2c_send(dt) || i2c_check_idle(0x5)) {
+        return I2C_TIMEOUT;
+    }
     return SSP1CON2bits.ACKSTAT;
 }
+#endif
 
 /**
  * !@brief Receive data from slave
  *
+ * With I2C_PIPELINE, ACK means another i2c_receive() follows, so the next
+ * byte is received while the caller works on this one.
  * @param[in] ack ACK data after received
- * @return Received data
+ * @return Received data. 0xff when the bus error occurred.
  */
 char i2c_receive(int ack)
 {
-    char dt;
+    char dt = 0xff;
 
-    i2c_check_idle(0x5);
-    SSP1CON2bits.RCEN = 1;      // Enable receive
-    i2c_check_idle(0x4);
-    dt = SSP1BUF;               // Receive data
-    i2c_check_idle(0x5);
-    SSP1CON2bits.ACKDT = ack;
-    SSP1CON2bits.ACKEN = 1;     // Response ACK
+    #ifdef I2C_PIPELINE
+    if (i2c_prefetch == 0)
+    #endif
+    {
+        if (i2c_check_idle(0x5)) {
+            return dt;
+        }
+        SSP1CON2bits.RCEN = 1;      // Enable receive
+    }
+    #ifdef I2C_PIPELINE
+    i2c_prefetch = 0;
+    #endif
+    if (i2c_check_idle(0x4) == 0) {
+        dt = SSP1BUF;               // Receive data
+        if (i2c_check_idle(0x5) == 0) {
+            SSP1CON2bits.ACKDT = ack;
+            SSP1CON2bits.ACKEN = 1; // Response ACK
+            #ifdef I2C_PIPELINE
+            if (ack == ACK && i2c_check_idle(0x5) == 0) {
+                SSP1CON2bits.RCEN = 1;  // Receive the next byte
+                i2c_prefetch = 1;
+            }
+            #endif
+        }
+    }
     return dt;
 }
+
+#ifdef I2C_PRIORITY
+/**
+ * !@brief Let the urgent work use the bus
+ *
+ * Interruptible transfers call this between bytes. When the urgent work is
+ * waiting, end the transaction and run i2c_urgent_proc(). The caller starts
+ * the transaction again and resumes from the next byte.
+ * i2c_urgent_proc() must not use the device which yielded.
+ * @return 0:not yielded, others:I2C_YIELDED | result of the ended transaction
+ */
+char i2c_yield(void)
+{
+    char ret;
+
+    if (i2c_urgent == 0 || i2c_error != 0) {
+        return 0;
+    }
+    ret = (char)i2c_stop() | I2C_YIELDED;
+    i2c_urgent = 0;
+    i2c_urgent_proc();
+    return ret;
+}
+#endif
@@ -27,12 +27,47 @@
 #define RW_0  0
 #define RW_1  1
 
+// Result codes are bits, so results of a transaction can be ORed.
+//   0:success  1(bit0):NACK  I2C_TIMEOUT(bit1):bus was stuck or collided
+#define I2C_TIMEOUT     2
+#define I2C_YIELDED     4   // i2c_yield() ended the transaction for urgent work
+
+// Max polls of each wait for the MSSP.
+// A poll is about 15 instruction cycles, so each wait is bounded to
+// 250 * 15 / 2MHz = about 2ms at 8MHz, the recovery adds about 0.1ms.
+// Sending one byte at 100kHz takes 90us (about 12 polls).
+#define I2C_WAIT_COUNT  250
+
+//#define I2C_PIPELINE    // Work on the next byte while a byte is on the bus
+//#define I2C_PRIORITY    // Urgent work goes ahead of the LCD transfers
+
+#ifndef _XTAL_FREQ
+// Unless already defined assume 8MHz system frequency
+// This definition is required to calibrate __delay_us() and __delay_ms()
+#define _XTAL_FREQ 8000000
+#endif
+
 void i2c_interrupt(void);
 void i2c_init_master(void);
+void i2c_recover(void);
+char i2c_check_idle(char mask);
 int  i2c_start(int adrs,int rw);
 int  i2c_rstart(int adrs,int rw);
-void i2c_stop(void);
+int  i2c_stop(void);
+void i2c_sleep(void);
+void i2c_wake(void);
 int  i2c_send(char dt);
+#ifdef I2C_PIPELINE
+int  i2c_send_address(char dt);
+#else
+#define i2c_send_address    i2c_send
+#endif
 char i2c_receive(int ack);
 
+#ifdef I2C_PRIORITY
+extern volatile char i2c_urgent;
+void i2c_urgent_proc(void);     // Urgent work, defined by the application
+char i2c_yield(void);
+#endif
+
 #endif
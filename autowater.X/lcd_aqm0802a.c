@@ -26,28 +26,96 @@
 //  - i2c protocol
 //  - http://akizukidenshi.com/catalog/g/gP-06669/
 
-#include <xc.h>
+#include "hal.h"
 #include "i2c.h"
+#include "delay.h"
 #include "lcd_aqm0802a.h"
 
 #define LCD_ADDR 0x3E       // i2c address
 
+static char lcd_state;      // power state (LCD_POWER_ON..LCD_POWER_UP)
+#ifdef DELAY_SLEEP
+static unsigned char lcd_ready; // deadline of LCD_POWER_UP (delay_tick)
+#endif
+
+#ifdef LCD_GLYPH_CACHE
+static char glyph_id[LCD_GLYPH_SLOTS];  // glyph in each slot (0xff: empty)
+static char glyph_rank[LCD_GLYPH_SLOTS];// 0:most .. SLOTS-1:least recently used
+#endif
+
+#ifdef DELAY_SLEEP
+/**
+ * !@brief Wait until the follower is stable after LCD_POWER_UP
+ *
+ * Sleeps until the deadline, then leaves the instruction table, so the
+ * display is LCD_DISPLAY_OFF. Every transfer starts with this.
+ */
+static void lcd_wait_ready(void)
+{
+    if (lcd_state == LCD_POWER_UP) {
+        while (!delay_passed(lcd_ready)) {
+            delay_ms(DELAY_SLEEP_MIN);
+        }
+        lcd_state = LCD_DISPLAY_OFF;
+        if (i2c_start(LCD_ADDR, RW_0) == 0) {
+            i2c_send(0b10000000);
+            i2c_send(0x38);     // Function set : disalbe instruction table
+        }
+        i2c_stop();
+    }
+}
+#define lcd_start() (lcd_wait_ready(), i2c_start(LCD_ADDR, RW_0))
+#else
+#define lcd_start() i2c_start(LCD_ADDR, RW_0)
+#endif
+
+#ifdef I2C_PRIORITY
+static char lcd_addr;       // DDRAM address to resume lcd_puts()
+
+/**
+ * !@brief Start the data transfer again after i2c_yield()
+ *
+ * @param[in] addr DDRAM address of the next character
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+static int lcd_resume(char addr)
+{
+    int  ret;
+
+    ret = lcd_start();
+    if (ret == 0) {
+        i2c_send(0b10000000);   // control byte: command follows
+        i2c_send(0x80 | addr);  // Set DDRAM address
+        i2c_send(0b01000000);   // control byte: data follow
+    }
+    return ret;
+}
+#endif
+
+// Note: Most instructions and data take 26.3us to execute.
+//       At 100kHz one byte on i2c takes 90us, so the next byte never comes
+//       before the execution finished and no wait is needed after them.
+//       Only clear display (1.08ms), follower control (200ms) and
+//       power on (40ms) need waits.
+//       host/build/sim checks these timings with the model of ST7032.
+
 /**
  * !@brief Send command to lcd
  *
  * @param[in] c Command code
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-static void lcd_command(unsigned char c)
+static int lcd_command(unsigned char c)
 {
     int  ret;
 
-    ret = i2c_start(LCD_ADDR, RW_0);
+    ret = lcd_start();
     if (ret == 0) {
         i2c_send(0b10000000);
         i2c_send(c);
     }
-    i2c_stop();
-    __delay_us(26);
+    ret |= i2c_stop();
+    return ret;
 }
 
 /**
@@ -57,27 +125,93 @@ void lcd_init(void)
 {
     i2c_init_master();
 
-    __delay_ms(40);         // Wait 40ms after power on
+    delay_ms(40);           // Wait 40ms after power on
     lcd_command(0x38);      // Function set : 8bits, 2lines
     lcd_command(0x39);      // Function set : select instruction table
     lcd_command(0x14);      // Internal OSC frequency
     lcd_command(0x70);      // Contrast set
     lcd_command(0x56);      // Power/ICON/Contrast control
     lcd_command(0x6C);      // Follower control
-    __delay_ms(200);        // Wait 200ms
+    delay_ms(200);          // Wait 200ms
     lcd_command(0x38);      // Function set : disalbe instruction table
     lcd_command(0x0c);      // Display ON : Curosr OFF, Blink OFF
     lcd_command(0x06);      // Entry mode set : move cursor to right after put character
     lcd_clear();            // Clear Display
+
+    #ifdef LCD_GLYPH_CACHE
+    for (char i=0; i<LCD_GLYPH_SLOTS; i++) {
+        glyph_id[i] = 0xff; // CGRAM is undefined after power on
+        glyph_rank[i] = i;
+    }
+    #endif
+}
+
+/**
+ * !@brief Change the power state
+ *
+ * DDRAM, CGRAM and the cursor are kept in every state, so the screen comes
+ * back without drawing it again. Turning on from LCD_POWER_DOWN waits
+ * 200ms for the voltage of the follower. With DELAY_SLEEP it doesn't wait:
+ * the state is LCD_POWER_UP, the next transfer sleeps until 200ms passed and
+ * the display turns on when LCD_POWER_ON is requested after that.
+ * @param[in] state LCD_POWER_ON, LCD_DISPLAY_OFF or LCD_POWER_DOWN
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+int lcd_power(char state)
+{
+    int ret = 0;
+
+    if (state == lcd_state) {
+        return 0;
+    }
+    if (state == LCD_POWER_ON) {
+        if (lcd_state == LCD_POWER_DOWN) {
+            ret |= lcd_command(0x39);   // Function set : select instruction table
+            ret |= lcd_command(0x56);   // Power/ICON/Contrast control : booster on
+            ret |= lcd_command(0x6C);   // Follower control : follower on
+            #ifdef DELAY_SLEEP
+            lcd_ready = delay_deadline(200); // Not before 200ms (lcd_wait_ready())
+            lcd_state = LCD_POWER_UP;
+            return ret;
+            #else
+            __delay_ms(200);            // Wait 200ms
+            ret |= lcd_command(0x38);   // Function set : disalbe instruction table
+            #endif
+        }
+        #ifdef DELAY_SLEEP
+        if (lcd_state == LCD_POWER_UP && !delay_passed(lcd_ready)) {
+            return ret;                 // the follower isn't stable yet
+        }
+        #endif
+        ret |= lcd_command(0x0c);       // Display ON : Curosr OFF, Blink OFF
+    } else {
+        ret |= lcd_command(0x08);       // Display OFF
+        if (state == LCD_POWER_DOWN) {
+            ret |= lcd_command(0x39);   // Function set : select instruction table
+            ret |= lcd_command(0x52);   // Power/ICON/Contrast control : booster off
+            ret |= lcd_command(0x64);   // Follower control : follower off
+            ret |= lcd_command(0x38);   // Function set : disalbe instruction table
+        }
+    }
+    lcd_state = state;
+    return ret;
 }
 
 /**
  * !@brief Clear display
+ *
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_clear(void)
+int lcd_clear(void)
 {
-    lcd_command(0x01);      // Fill 20h, cursor to (0,0)
-    __delay_us(1100);       // wait 1.08ms
+    int ret;
+
+    ret = lcd_command(0x01);    // Fill 20h, cursor to (0,0)
+    __delay_us(1100);           // wait 1.08ms
+    #ifdef I2C_PRIORITY
+    lcd_addr = 0;
+    #endif
+    return ret;
 }
 
 /**
@@ -85,11 +219,15 @@ void lcd_clear(void)
  *
  * @param[in] col Position of horizontal. Range => 0..7
  * @param[in] row Position of vertical. Range => 0..1
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_set_cursor(char col, char row)
+int lcd_set_cursor(char col, char row)
 {
     int row_offsets[] = {0x00, 0x40};
-    lcd_command(0x80 | (col + row_offsets[row]));
+    #ifdef I2C_PRIORITY
+    lcd_addr = col + row_offsets[row];
+    #endif
+    return lcd_command(0x80 | (col + row_offsets[row]));
 }
 
 /**
@@ -97,57 +235,126 @@ void lcd_set_cursor(char col, char row)
  *
  * @param[in] col Position of horizontal. Range => 0..7
  * @param[in] row Position of vertical. Range => 0..1
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_show_cursor(char col, char row)
+int lcd_show_cursor(char col, char row)
 {
-    lcd_set_cursor(col, row);
-    lcd_command(0x0c | 0x1);
+    int ret;
+
+    ret = lcd_set_cursor(col, row);
+    return ret | lcd_command(0x0c | 0x1);
 }
 
 /**
  * !@brief Hide the cursor
+ *
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_hide_cursor(void)
+int lcd_hide_cursor(void)
 {
-    lcd_command(0x0c);
+    return lcd_command(0x0c);
 }
 
 /**
  * !@brief Put the character
  *
  * @param[in] c Character to put
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_putc(char c)
+int lcd_putc(char c)
 {
     int  ret;
 
-    ret = i2c_start(LCD_ADDR, RW_0);
+    ret = lcd_start();
     if (ret == 0) {
         i2c_send(0b11000000);   // send control byte
         i2c_send(c);
     }
-    i2c_stop();
-    __delay_us(26);
+    ret |= i2c_stop();
+    return ret;
 }
 
 /**
  * !@brief Put the string
  *
  * @param[in] s Address of string to put
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_puts(const char * s)
+int lcd_puts(const char * s)
 {
     int  ret;
 
-    ret = i2c_start(LCD_ADDR, RW_0);
+    #ifdef I2C_PRIORITY
+    char y;
+    #endif
+
+    ret = lcd_start();
     if (ret == 0) {
         i2c_send(0b01000000);   // send control byte
         while(*s) {
+            #ifdef I2C_PRIORITY
+            y = i2c_yield();
+            if (y != 0) {
+                ret = (y & ~I2C_YIELDED) | lcd_resume(lcd_addr);
+                if (ret != 0) {
+                    break;
+                }
+            }
+            lcd_addr++;
+            #endif
             i2c_send(*s++);
-            __delay_us(26);
         }
     }
-    i2c_stop();
+    return ret | i2c_stop();
+}
+
+/**
+ * !@brief Put the characters of the cells in the mask
+ *
+ * Sends only the cells which have a bit in the mask in one transaction.
+ * The address is set again only when the cell isn't next to the last one.
+ *
+ * @param[in] row Position of vertical. Range => 0..1
+ * @param[in] s Address of the characters of the row (8 characters)
+ * @param[in] mask Cells to put. bit0 => column 0 .. bit7 => column 7
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+int lcd_put_cells(char row, const char *s, unsigned char mask)
+{
+    int  ret;
+    char col, next;
+    #ifdef I2C_PRIORITY
+    char y;
+    #endif
+
+    if (mask == 0) {
+        return 0;
+    }
+    ret = lcd_start();
+    next = -1;
+    for (col=0; ret == 0 && mask != 0; col++, mask >>= 1) {
+        if ((mask & 1) == 0) {
+            continue;
+        }
+        #ifdef I2C_PRIORITY
+        y = i2c_yield();
+        if (y != 0) {
+            ret = (y & ~I2C_YIELDED) | lcd_start();
+            if (ret != 0) {
+                break;
+            }
+            next = -1;
+        }
+        #endif
+        if (col != next) {
+            i2c_send(0b10000000);           // control byte: command follows
+            i2c_send(0x80 | (col + (row ? 0x40 : 0x00)));
+        }
+        i2c_send(0b11000000);               // control byte: data follows
+        ret = i2c_send(s[col]);
+        next = col + 1;
+    }
+    return ret | i2c_stop();
 }
 
 /**
@@ -155,24 +362,68 @@ void lcd_puts(const char * s)
  *
  * @param[in] Address of font
  * @param[in] Buffer of image
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void lcd_create_char(char p, char *dt)
+int lcd_create_char(char p, const char *dt)
 {
     int ret, i;
 
-    ret = i2c_start(LCD_ADDR, RW_0);
+    ret = lcd_start();
     if (ret == 0) {
         // Set the address
         i2c_send(0b10000000);   // send control byte
         i2c_send(0x40 | (p << 3));
-        __delay_us(26);
 
         // Register image
         i2c_send(0b01000000);   // send control byte
         for (i=0; i < 7; i++) {
             i2c_send(*dt++);
-            __delay_us(26);
         }
     }
-    i2c_stop();
+    return ret | i2c_stop();
+}
+
+#ifdef LCD_GLYPH_CACHE
+/**
+ * !@brief Get the character code of the glyph
+ *
+ * CGRAM slots are a cache of glyphs. The image is sent only when the glyph
+ * isn't in CGRAM, then it replaces the least recently used glyph.
+ * After sending, set the cursor again before putting characters.
+ * @param[in] id ID of the glyph (0..0xfe)
+ * @param[in] dt Image of the glyph (7 rows)
+ * @return Character code (0x08..0x0f, usable in strings unlike 0x00)
+ */
+char lcd_glyph(char id, const char *dt)
+{
+    char i, slot = 0xff;
+
+    for (i=0; i<LCD_GLYPH_SLOTS; i++) {
+        if (glyph_id[i] == id) {
+            slot = i;
+        }
+    }
+    if (slot == 0xff) {
+        // Replace the least recently used (empty slots were never used)
+        for (i=0; i<LCD_GLYPH_SLOTS; i++) {
+            if (glyph_rank[i] == LCD_GLYPH_SLOTS - 1) {
+                slot = i;
+            }
+        }
+        glyph_id[slot] = 0xff;
+        if (lcd_create_char(slot, dt) != 0) {
+            return 0x08 | slot;     // stays the least recently used
+        }
+        glyph_id[slot] = id;
+    }
+
+    // Make it the most recently used
+    for (i=0; i<LCD_GLYPH_SLOTS; i++) {
+        if (glyph_rank[i] < glyph_rank[slot]) {
+            glyph_rank[i]++;
+        }
+    }
+    glyph_rank[slot] = 0;
+    return 0x08 | slot;
 }
+#endif
@@ -28,13 +28,27 @@
 #define _XTAL_FREQ 8000000
 #endif
 
+//#define LCD_GLYPH_CACHE     // Keep glyphs in CGRAM as a cache (lcd_glyph())
+#define LCD_GLYPH_SLOTS 8       // CGRAM slots for the cache (2 bytes of RAM each)
+
+// Power states of lcd_power()
+#define LCD_POWER_ON    0   // Display on
+#define LCD_DISPLAY_OFF 1   // Display off. DDRAM is kept and turns on at once
+#define LCD_POWER_DOWN  2   // Booster and follower off too. Turning on takes 200ms
+#define LCD_POWER_UP    3   // Turning on from LCD_POWER_DOWN (DELAY_SLEEP only)
+
 void lcd_init(void);
-void lcd_clear(void);
-void lcd_set_cursor(char col, char row);
-void lcd_show_cursor(char col, char row);
-void lcd_hide_cursor(void);
-void lcd_putc(char c);
-void lcd_puts(const char * s);
-void lcd_create_char(char p, char *dt);
+int  lcd_power(char state);
+int  lcd_clear(void);
+int  lcd_set_cursor(char col, char row);
+int  lcd_show_cursor(char col, char row);
+int  lcd_hide_cursor(void);
+int  lcd_putc(char c);
+int  lcd_puts(const char * s);
+int  lcd_put_cells(char row, const char *s, unsigned char mask);
+int  lcd_create_char(char p, const char *dt);
+#ifdef LCD_GLYPH_CACHE
+char lcd_glyph(char id, const char *dt);
+#endif
 
 #endif
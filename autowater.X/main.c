@@ -23,11 +23,17 @@
 // Processor : PIC 12F1822
 // Compiler  : MPLAB(R) XC8 C Compiler Version 1.30
 
-#include <xc.h>
+#include "hal.h"
 #include "i2c.h"
 #include "lcd_aqm0802a.h"
 #include "rtc_8564nb.h"
 #include "button.h"
+#include "delay.h"
+#include "uart.h"
+#include "soil.h"
+#include "vdd.h"
+#include "osccal.h"
+#include "gpio_pcf8574.h"
 
 // Setting configuration1
 // Data Memory Code Protection
@@ -43,7 +49,11 @@
 // MCLR Pin Function Select
 #pragma config MCLRE = OFF
 // Watchdog Timer Enable (OFF,ON,NSLEEP,SWDTEN)
+#ifdef DELAY_SLEEP
+#pragma config WDTE = SWDTEN    // wakes up delay_ms()
+#else
 #pragma config WDTE = OFF
+#endif
 // Flash Program Memory Code Protection
 #pragma config CP = OFF
 // Power-up Timer Enable
@@ -65,9 +75,20 @@
 
 
 // Defines
+#if defined(UART_TELEMETRY) || defined(SOIL_SENSOR)
+#define RTCINTPIN             (1<<3)    // RA3 RTC-INT interrupt (RA4/RA5 are TX/RX or sensor)
+#define SW1                   0         // no switches
+#define SW2                   0
+#else
 #define RTCINTPIN             (1<<5)    // RA5 RTC-INT interrupt
 #define SW1                   (1<<4)    // RA4 is switch 1
 #define SW2                   (1<<3)    // RA3 is switch 2
+#endif
+#ifdef SOIL_SENSOR
+#define PULLUP_PINS           0b00001110 // RA1,RA2,RA3 (RA4/RA5 are of the sensor)
+#else
+#define PULLUP_PINS           0b00111110 // RA1,RA2,RA3,RA4,RA5
+#endif
 #define RELAY                 RA0       // RA0 is relay port
 #define RELAY_BIT             (1<<0)    // RA0 is relay port (bit)
 
@@ -76,6 +97,85 @@
 #define ONE_SEC               ((WORD)(1000L * 1000L / FREQ))  // one second of WORD value
 #define SLEEPING_TIME         ((WORD)(60000L * 1000L / FREQ)) // sleep time
 
+//#define INCREMENTAL_CLOCK           // Redraw only the changed digits of clock
+
+//#define RELAY_IN_ISR                // Turn on the relay in interrupt by alarm
+//#define LCD_SLEEP_STATE LCD_POWER_DOWN // LCD state while sleeping (keeps screen)
+//#define STATUS_ICONS                // Show alarm and pump icons on the clock
+//#define SLEEP_GATING                // Stop MSSP, Timer0 and leaking pull-ups in sleep
+//#define MINUTE_CLOCK                // Date and hh:mm kept on the screen in sleep
+//#define HEADLESS                    // No LCD: status by flashes, settings in EEPROM
+//#define LATENCY_STATS               // Histogram of button press to screen drawn
+
+#if defined(STATUS_ICONS) && !defined(LCD_GLYPH_CACHE)
+#error "STATUS_ICONS needs LCD_GLYPH_CACHE (lcd_aqm0802a.h)"
+#endif
+#if defined(MINUTE_CLOCK) && (defined(LCD_SLEEP_STATE) || defined(RELAY_IN_ISR))
+#error "MINUTE_CLOCK keeps the LCD on and shares /INT with the alarm"
+#endif
+#if defined(HEADLESS) && (defined(MINUTE_CLOCK) || defined(STATUS_ICONS) || defined(LCD_SLEEP_STATE))
+#error "HEADLESS has no LCD"
+#endif
+#if defined(UART_TELEMETRY) && (!defined(HEADLESS) || defined(DELAY_SLEEP))
+#error "UART_TELEMETRY needs the pins of HEADLESS and stops in the naps of DELAY_SLEEP"
+#endif
+#if defined(SOIL_SENSOR) && (!defined(HEADLESS) || defined(UART_TELEMETRY) || defined(RELAY_IN_ISR))
+#error "SOIL_SENSOR needs the pins of HEADLESS and decides the relay in alarm_proc()"
+#endif
+#if defined(LATENCY_STATS) && defined(HEADLESS)
+#error "LATENCY_STATS shows the histogram on the LCD"
+#endif
+#if defined(VALVE_ZONES) && (VALVE_ZONES < 1 || 8 < VALVE_ZONES || defined(RELAY_IN_ISR))
+#error "VALVE_ZONES is 1-8 and decides the session in alarm_proc()"
+#endif
+
+#ifdef HEADLESS
+// EEPROM: the settings, edit them before programming
+#define EE_USE_ALARM          0         // use_alarm
+#define EE_ALARM_TIME         1         // alarm_time[0] (minute), [1] (hour)
+#define EE_PON_TIME           3         // poweron_time [sec]
+__EEPROM_DATA(1, 0, 7, 10, 0xff, 0xff, 0xff, 0xff); // alarm ON at 07:00, 10 sec
+
+// Status shown by flashes of the relay LED, shorter than the relay operates
+#define FLASH_MS              2         // on time of a flash
+#define FLASH_GAP_MS          300       // off time between flashes
+#define STATUS_ALARM_OFF      1         // number of flashes
+#define STATUS_ALARM_ON       2
+#define STATUS_RTC_ERROR      3
+#define STATUS_LOW_BATTERY    4         // VDD_MONITOR
+#endif
+
+#ifdef LATENCY_STATS
+// Latency of a button: the edge (IOC), taken by the loop, the screen drawn
+#define LAT_IDLE              0
+#define LAT_EDGE              1         // lat_tmr0, lat_ticks are of the edge
+#define LAT_TAKEN             2         // the loop got the press on lat_shown
+#define LAT_SEEN              3         // the next screen reflects the press
+#define LATENCY_BUCKETS       7         // <16ms, <33ms, ... <524ms, >524ms
+#define LATENCY_SHIFT         7         // 128us of TMR0 to 16.4ms of bucket 0
+#define EE_LATENCY            16        // EEPROM: copy of latency_hist[]
+#endif
+
+#ifdef VDD_MONITOR
+// Power policy by vdd_level: normal, low, empty
+#ifndef HEADLESS
+const WORD idle_timeout[] = {SLEEPING_TIME, SLEEPING_TIME / 2, SLEEPING_TIME / 6};
+const unsigned char refresh_mask[] = {0, 1, 3};   // show_clock() every 1, 2, 4 loops
+#define IDLE_TIMEOUT          idle_timeout[vdd_level]
+#endif
+#else
+#define IDLE_TIMEOUT          SLEEPING_TIME
+#endif
+
+#ifdef I2C_PRIORITY
+// The 50ms wait of loop() ends after the chunk an alarm arrived in
+#ifdef DELAY_SLEEP
+#define LOOP_WAIT_CHUNK       DELAY_SLEEP_MIN // sleeps until the WDT
+#else
+#define LOOP_WAIT_CHUNK       1
+#endif
+#endif
+
 #define SHOW_CLOCK            0
 #define SET_CLOCK_DATE_YEAR   1
 #define SET_CLOCK_DATE_MONTH  2
@@ -89,18 +189,93 @@
 #define SET_ALARM_MIN         10
 #define SHOW_PON_TIME         11
 #define SET_PON_TIME          12
+#define SHOW_LATENCY          13        // LATENCY_STATS
+
+// RAM overlay: the scratch of each mode shares the same bytes.
+// A mode initializes its member when it is entered.
+typedef union {
+    char text[6];                   // SHOW_ALARM..SET_PON_TIME: "hh:mm", "99sec"
+    struct {                        // SHOW_CLOCK, SET_CLOCK_*
+        char str[18];               // "yyyymmdd\0hh:mm:ss\0"
+        unsigned char time[7];      // current time
+        #ifdef INCREMENTAL_CLOCK
+        char shown[7];              // time on the screen (0xff: redraw all)
+        #endif
+    } clock;
+    #ifdef LATENCY_STATS
+    struct {                        // SHOW_LATENCY
+        char count[4];              // "255"
+        unsigned char page;         // bucket shown
+    } latency;
+    #endif
+} mode_ram_t;
+
+#define MODE_RAM_BUDGET       32        // bytes for the overlay
+typedef char mode_ram_over_budget[(sizeof(mode_ram_t) <= MODE_RAM_BUDGET) ? 1 : -1];
+
+// Views of the overlay in the clock modes
+#define buf                   mode_ram.clock.str
+#define current_time          mode_ram.clock.time
+#define shown_time            mode_ram.clock.shown
 
 // Global values
 unsigned char use_alarm;            // preference: whether alarm used
 unsigned char alarm_time[2];        // preference: minute and hour
 unsigned char poweron_time = 10;    // preference: power on interval [sec]
+#ifdef HEADLESS
+unsigned char status;               // flashes of flash_status()
+#ifdef UART_TELEMETRY
+unsigned short pump_runs;           // pumps since reset
+#endif
+#else
 unsigned char mode;                 // mode
 unsigned char setting_value;        // current setting value
-unsigned char current_time[7];      // current time
-char buf[18];                       // temporary buffer
+mode_ram_t mode_ram;                // scratch of the current mode
+#endif
 unsigned char interrupted_alarm = 0;// flag of interrupted alarm
 unsigned short poweron_remain;      // remain time for power on
-const char *on_off_str[] = {"OFF", "ON "};
+#ifdef OSC_CALIBRATION
+unsigned char osc_due;              // calibrate before the next sleep
+#endif
+#ifdef SLEEP_GATING
+unsigned char sleep_held;           // wake pins held LO at SLEEP()
+#endif
+#ifdef VALVE_ZONES
+unsigned short zone_ticks;          // pump time of a zone in timer count
+#endif
+#ifdef VDD_MONITOR
+unsigned char vdd_level;            // supply: 0:normal 1:low 2:empty
+#ifndef HEADLESS
+unsigned char refresh_count;        // loops for refresh_mask[]
+#endif
+#endif
+#ifdef RELAY_IN_ISR
+unsigned short poweron_ticks = ONE_SEC * 10; // poweron_time in timer count
+#endif
+#ifdef LATENCY_STATS
+unsigned char lat_state;            // LAT_IDLE..LAT_SEEN
+unsigned char lat_tmr0;             // TMR0 at the edge
+unsigned char lat_ticks;            // timer interrupts since the edge
+unsigned char lat_screen;           // hash of the mode and the screen drawn last
+unsigned char lat_shown;            // lat_screen when the press was taken
+unsigned char latency_hist[LATENCY_BUCKETS]; // presses by bucket
+const char * const latency_label[] = {
+    " <16ms", " <33ms", " <66ms", "<131ms", "<262ms", "<524ms", ">524ms"
+};
+#endif
+#ifndef HEADLESS
+const char * const on_off_str[] = {"OFF", "ON "};
+#endif
+#ifdef STATUS_ICONS
+#define ICON_ALARM            0         // glyph ID of the alarm icon
+#define ICON_PUMP             1         // glyph ID of the pump icon
+#define ICON_BATTERY          2         // glyph ID of the low battery icon
+const char icon_alarm[] = {0x04, 0x0e, 0x0e, 0x0e, 0x1f, 0x00, 0x04}; // bell
+const char icon_pump[]  = {0x04, 0x04, 0x0a, 0x0a, 0x11, 0x11, 0x0e}; // drop
+#ifdef VDD_MONITOR
+const char icon_battery[] = {0x0e, 0x1b, 0x11, 0x11, 0x11, 0x1f, 0x1f}; // low battery
+#endif
+#endif
 
 // Define struct
 typedef struct {
@@ -123,6 +298,14 @@ typedef struct {
 } set_alarm_time_t;
 
 // Prototypes
+#ifdef HEADLESS
+void start_settings(void);
+void flash_status(void);
+#ifdef UART_TELEMETRY
+void serial_proc(void);
+void send_status(void);
+#endif
+#else
 void show_clock(void);
 void set_clock(char set_pos);
 void show_alarm(void);
@@ -134,6 +317,32 @@ void show_cursor(char cursor_pos);
 void show_pon_time(void);
 void set_pon_time(void);
 void make_pon_str(void);
+#ifdef LATENCY_STATS
+void show_latency(void);
+void latency_proc(const char *first_line, const char *second_line);
+void latency_save(void);
+#endif
+#endif
+void alarm_proc(void);
+#ifdef STATUS_ICONS
+char set_status_icon(void);
+#endif
+#ifdef SLEEP_GATING
+void sleep_enter(void);
+char sleep_exit(void);
+#endif
+#ifdef VDD_MONITOR
+void vdd_check(void);
+#endif
+#ifdef OSC_CALIBRATION
+void osc_proc(char windows);
+#endif
+#ifdef VALVE_ZONES
+void zone_proc(void);
+#endif
+#ifdef RELAY_IN_ISR
+void set_poweron_ticks(void);
+#endif
 
 /**
  * !@brief Interrupt function
@@ -143,24 +352,54 @@ void interrupt interrupt_func(void)
     // timer interrupt
     if (T0IF == 1) {
         #ifdef T0CNT
+        #ifdef DELAY_SLEEP
+        TMR0 += T0CNT;  // keep the time advanced by delay_ms()
+        #else
         TMR0 = T0CNT;
         #endif
+        #endif
         T0IF = 0;
         poweron_remain--;
         if (poweron_remain == 0) {
             RELAY = 0;
         }
         button_proc_every_timer_interrupt();
+        #ifdef DELAY_SLEEP
+        delay_proc_every_timer_interrupt();
+        #endif
+        #ifdef LATENCY_STATS
+        if (lat_ticks != 0xff) {
+            lat_ticks++;
+        }
+        #endif
     }
 
     // I2C interrupt handler
     i2c_interrupt();
 
+    #ifdef UART_TELEMETRY
+    uart_interrupt();
+    #endif
+
     // alarm interrupt from RTC
     if (IOCIF == 1) {
         if ((IOCAF & RTCINTPIN) != 0) {
+            #ifdef RELAY_IN_ISR
+            poweron_remain = poweron_ticks;
+            RELAY = 1;
+            #endif
             interrupted_alarm = 1;
+            #ifdef I2C_PRIORITY
+            i2c_urgent = 1;
+            #endif
         }
+        #ifdef LATENCY_STATS
+        if ((IOCAF & (SW1|SW2)) != 0 && lat_state == LAT_IDLE) {
+            lat_tmr0 = TMR0;
+            lat_ticks = 0;
+            lat_state = LAT_EDGE;
+        }
+        #endif
         IOCAF = 0;
     }
 
@@ -185,7 +424,7 @@ void init(void)
     ANSELA     = 0b00000000;    // Not use alalog select register
     TRISA      = 0b00111110;    // Input: RA1(SCL)/RA2(SDA), RA3(INT), RA4/RA5(switch)
                                 // Output: RA0(relay)
-    WPUA       = 0b00111110;    // Using Pull-up: RA1,RA2,RA3,RA4,RA5
+    WPUA       = PULLUP_PINS;   // Using Pull-up: RA1,RA2,RA3,RA4,RA5
     PORTA      = 0b00000000;    // Initialize all GPIO to LO
 
     IOCIE = 1;                  // Enable Interrupt-on-Change bit
@@ -204,23 +443,253 @@ void init(void)
     // Initialize button library
     button_init(SW1|SW2);
 
+#ifdef HEADLESS
+    // Load the settings
+    use_alarm = eeprom_read(EE_USE_ALARM);
+    alarm_time[0] = eeprom_read(EE_ALARM_TIME);
+    alarm_time[1] = eeprom_read(EE_ALARM_TIME + 1);
+    poweron_time = eeprom_read(EE_PON_TIME);
+    #ifdef RELAY_IN_ISR
+    set_poweron_ticks();
+    #endif
+
+    // Initialize RTC
+    status = STATUS_RTC_ERROR;
+    if (rtc_init(start_clock) == 0) {
+        start_settings();
+    }
+    #ifdef VDD_MONITOR
+    vdd_check();
+    #endif
+    #ifdef UART_TELEMETRY
+    uart_init();
+    #endif
+    #ifdef SOIL_SENSOR
+    soil_init();
+    #endif
+    #ifdef OSC_CALIBRATION
+    osc_proc(OSCCAL_BOOT);
+    #endif
+#else
+    #ifndef OSC_CALIBRATION
     // Initialize LCD
     lcd_init();
     lcd_set_cursor(0, 0);
     lcd_puts("Hello");
+    #endif
 
     // Initialize RTC
     rtc_init(start_clock);
+    #ifdef VDD_MONITOR
+    vdd_check();
+    #endif
+    #ifdef OSC_CALIBRATION
+    osc_proc(OSCCAL_BOOT);
+    lcd_init();     // the waits of the LCD are just of the data sheet
+    #endif
+#endif
+    #ifdef DELAY_SLEEP
+    delay_calibrate(RTCINTPIN); // the period of the WDT for delay_ms()
+    #endif
+    #ifdef VALVE_ZONES
+    gpio_init();    // all valves closed
+    #endif
+    #ifdef MINUTE_CLOCK
+    rtc_start_repeated_timer(RTC_TIMER_1MIN, 1);    // wakes up every minute
+    #endif
+}
+
+#ifdef HEADLESS
+/**
+ * !@brief Set the alarm of RTC by the settings and update the status
+ */
+void start_settings(void)
+{
+    status = STATUS_ALARM_OFF;
+    if (use_alarm) {
+        status = STATUS_ALARM_ON;
+        rtc_set_alarm(alarm_time);
+    } else {
+        rtc_stop_alarm();
+    }
+    #ifdef VDD_MONITOR
+    if (vdd_level != 0) {
+        status = STATUS_LOW_BATTERY;
+    }
+    #endif
+}
+
+/**
+ * !@brief Show the status by flashes of the relay LED
+ *
+ * A flash is shorter than the operate time of the relay, so only the LED
+ * lights and the pump doesn't run. Skipped while the pump runs.
+ */
+void flash_status(void)
+{
+    for (char i=status; i != 0 && RELAY == 0; i--) {
+        RELAY = 1;
+        __delay_ms(FLASH_MS);
+        RELAY = 0;
+        delay_ms(FLASH_GAP_MS);
+    }
+}
+
+/**
+ * !@brief Loop function
+ *
+ * Flash the status at boot and by SW1. Sleep whenever the pump is off
+ * and no button is pressed, or a button is held longer than a long press.
+ * With UART_TELEMETRY the status is also sent at boot and after the alarm,
+ * and it doesn't sleep while a frame is sent or received.
+ */
+void loop(void)
+{
+    flash_status();
+    #ifdef UART_TELEMETRY
+    send_status();
+    #endif
+    while(1) {
+        button_proc_every_main_loop(PORTA);
+        if (button_pressed_state & SW1) {
+            flash_status();
+        }
+        #ifdef UART_TELEMETRY
+        serial_proc();
+        #endif
+        if (interrupted_alarm) {
+            alarm_proc();
+            #ifdef UART_TELEMETRY
+            send_status();
+            #endif
+        }
+        #ifdef VALVE_ZONES
+        zone_proc();
+        #endif
+        if (RELAY == 0 && button_state == button_keep_long_pressed_state
+            #ifdef UART_TELEMETRY
+            && uart_busy() == 0
+            #endif
+            ) {
+            #ifdef VALVE_ZONES
+            zone_proc();    // closes the valve when the pump just stopped
+            #endif
+            #ifdef OSC_CALIBRATION
+            if (osc_due) {
+                osc_proc(OSCCAL_TRACK);
+                continue;   // the alarm during the calibration
+            }
+            #endif
+            PORTA = 0b00000000;
+            #ifdef UART_TELEMETRY
+            uart_sleep();
+            #endif
+            #ifdef SLEEP_GATING
+            do {
+                sleep_enter();
+                SLEEP();
+            } while (sleep_exit());
+            #else
+            SLEEP();
+            #endif
+            continue;   // the alarm or the button at once
+        }
+        delay_ms(50);
+    }
 }
 
+#ifdef UART_TELEMETRY
+/**
+ * !@brief Handle a received frame
+ *
+ * UART_CONFIG is checked against the ranges, then written to EEPROM and
+ * RTC like the settings at boot. Both UART_QUERY and UART_CONFIG get the
+ * status.
+ */
+void serial_proc(void)
+{
+    // ranges of UART_CONFIG payload
+    const static unsigned char config_min[] = {0, 0,  0,  1,  0,  0,  0,  1, 0, 1,  0};
+    const static unsigned char config_max[] = {1, 59, 23, 99, 59, 59, 23, 31, 6, 12, 99};
+    char type = uart_receive_frame();
+
+    if (type == UART_CONFIG) {
+        if (uart_frame_len != UART_CONFIG_LEN && uart_frame_len != UART_CONFIG_TIME_LEN) {
+            type = 0;
+        }
+        for (char i=0; i<uart_frame_len && type != 0; i++) {
+            if (uart_frame[i] < config_min[i] || config_max[i] < uart_frame[i]) {
+                type = 0;
+            }
+        }
+        if (type == 0) {
+            uart_bad_frames++;
+            return;
+        }
+        for (char i=0; i<UART_CONFIG_LEN; i++) {
+            eeprom_write(EE_USE_ALARM + i, uart_frame[i]);
+        }
+        use_alarm = uart_frame[0];
+        alarm_time[0] = uart_frame[1];
+        alarm_time[1] = uart_frame[2];
+        poweron_time = uart_frame[3];
+        #ifdef RELAY_IN_ISR
+        set_poweron_ticks();
+        #endif
+        if (uart_frame_len == UART_CONFIG_TIME_LEN) {
+            rtc_set_time(&uart_frame[UART_CONFIG_LEN]);
+        }
+        start_settings();
+    } else if (type != UART_QUERY) {
+        return;
+    }
+    send_status();
+}
+
+/**
+ * !@brief Send the status frame (see uart.h)
+ */
+void send_status(void)
+{
+    if (rtc_read_time(uart_frame) != 0) {
+        status = STATUS_RTC_ERROR;
+    }
+    uart_frame[7] = use_alarm;
+    uart_frame[8] = alarm_time[0];
+    uart_frame[9] = alarm_time[1];
+    uart_frame[10] = poweron_time;
+    uart_frame[11] = (unsigned char)pump_runs;
+    uart_frame[12] = (unsigned char)(pump_runs >> 8);
+    uart_frame[13] = status;
+    uart_frame[14] = uart_bad_frames;
+    uart_send_frame(UART_STATUS, uart_frame, UART_STATUS_LEN);
+}
+#endif
+#else
 /**
  * !@brief Loop function
  */
 void loop(void)
 {
     mode = 0;
+    #ifdef INCREMENTAL_CLOCK
+    shown_time[0] = 0xff;
+    #endif
     while(1) {
+        #ifdef LATENCY_STATS
+        unsigned char edge = (lat_state == LAT_EDGE);   // before PORTA is read
+        #endif
         button_proc_every_main_loop(PORTA);
+        #ifdef LATENCY_STATS
+        if (edge) {
+            if (button_pressed_state) {
+                lat_shown = lat_screen;
+                lat_state = LAT_TAKEN;
+            } else if (button_state == 0) {
+                lat_state = LAT_IDLE;   // a bounce, released before seen
+            }
+        }
+        #endif
         if (mode == SHOW_CLOCK) {
             show_clock();
         } else if (SET_CLOCK_DATE_YEAR <= mode && mode <= SET_CLOCK_TIME_SEC) {
@@ -235,34 +704,319 @@ void loop(void)
             show_pon_time();
         } else if (mode == SET_PON_TIME) {
             set_pon_time();
+        #ifdef LATENCY_STATS
+        } else if (mode == SHOW_LATENCY) {
+            show_latency();
+        #endif
         }
 
         if (interrupted_alarm) {
-            // If this code placed in interrupt function then program size is too bigger.
-            // (rtc_start_alarm code was dulilicated.)
-            // So this codes placed here.
-            interrupted_alarm = 0;
-            poweron_remain = ONE_SEC * (WORD)poweron_time;
-            RELAY = 1;
-            rtc_start_alarm();
+            alarm_proc();
         }
-        if (button_idle_timer > SLEEPING_TIME) {
+        #ifdef VALVE_ZONES
+        zone_proc();
+        #endif
+        #ifdef LCD_SLEEP_STATE
+        lcd_power(LCD_POWER_ON);    // after the screen was drawn on wake up
+        #endif
+        if (button_idle_timer > IDLE_TIMEOUT) {
+            #ifdef OSC_CALIBRATION
+            if (osc_due) {
+                osc_proc(OSCCAL_TRACK);
+                continue;   // the alarm during the calibration
+            }
+            #endif
             // go to sleep
             PORTA = 0b00000000;
+            #ifdef MINUTE_CLOCK
+            if (mode != SHOW_CLOCK) {
+                mode = SHOW_CLOCK;
+                #ifdef INCREMENTAL_CLOCK
+                shown_time[0] = 0xff;
+                #endif
+                lcd_clear();
+                continue;   // sleep with the clock on the screen
+            }
+            #elif defined(LCD_SLEEP_STATE)
+            lcd_power(LCD_SLEEP_STATE);
+            #else
             lcd_clear();
+            #endif
+            #ifdef LATENCY_STATS
+            latency_save();
+            #endif
+            #ifdef SLEEP_GATING
+            do {
+                sleep_enter();
+                SLEEP();
+            } while (sleep_exit());
+            #else
             SLEEP();
+            #endif
 
             // wake up here
             button_proc_every_main_loop(PORTA); // avoid to press button
+            #ifdef MINUTE_CLOCK
+            if (button_pressed_state == 0) {
+                #ifdef VDD_MONITOR
+                refresh_count = 0;  // the minute isn't skipped by the supply
+                #endif
+                continue;   // by RTC: redraw the minute, then sleep again
+            }
+            #endif
             button_idle_timer = 0;
             mode = SHOW_CLOCK;
+            #ifdef VDD_MONITOR
+            vdd_check();
+            refresh_count = 0;
+            #endif
+            #ifdef LATENCY_STATS
+            if (lat_state == LAT_EDGE) {
+                #ifdef SLEEP_GATING
+                lat_tmr0 = T0CNT;   // Timer0 restarted by sleep_exit()
+                #endif
+                lat_state = LAT_SEEN;   // the clock drawn next is of the waking press
+            }
+            #endif
+            #ifdef INCREMENTAL_CLOCK
+            shown_time[0] = 0xff;
+            #endif
+            #ifdef LCD_SLEEP_STATE
+            continue;   // draw the clock at once, then turn on the LCD
+            #endif
         }
         if (RELAY != 0) {
             button_idle_timer = 0;
         }
-        __delay_ms(50);
+        #ifdef I2C_PRIORITY
+        for (char i=50/LOOP_WAIT_CHUNK; i != 0 && interrupted_alarm == 0; i--) {
+            delay_ms(LOOP_WAIT_CHUNK);
+        }
+        #else
+        delay_ms(50);
+        #endif
     }
 }
+#endif
+
+#ifdef SLEEP_GATING
+/**
+ * !@brief Stop the peripherals before SLEEP()
+ *
+ * The falling edges of SW1, SW2 and RTC /INT wake up. A pin already held
+ * LO can't make the edge, so its rising edge (the release) wakes up
+ * instead, keeping its pull-up. SCL/SDA are left as inputs pulled up
+ * (the idle bus).
+ */
+void sleep_enter(void)
+{
+    i2c_sleep();
+    sleep_held = ~PORTA & (RTCINTPIN | SW1 | SW2);
+    TMR0IE = 0;
+    IOCAN = IOCAN & ~sleep_held;
+    IOCAP = sleep_held;
+}
+
+/**
+ * !@brief Restore what the woken up loop needs after SLEEP()
+ *
+ * The IOC for the buttons and the alarm, MSSP for the LCD and the RTC,
+ * and Timer0 for the buttons and the pump from the first tick.
+ * @return 1:woken up only by the release of a held pin, sleep again
+ *         0:woken up by the buttons or the alarm
+ */
+char sleep_exit(void)
+{
+    WORD idle;
+
+    IOCAP = 0;
+    IOCAN = IOCAN | RTCINTPIN | SW1 | SW2;
+    i2c_wake();
+    TMR0 = T0CNT;
+    TMR0IF = 0;
+    TMR0IE = 1;
+    if (sleep_held == 0 || interrupted_alarm ||
+        (~PORTA & (RTCINTPIN | SW1 | SW2)) != 0) {
+        return 0;
+    }
+    idle = button_idle_timer;
+    button_proc_every_main_loop(PORTA); // the release, the next press is new
+    button_idle_timer = idle;
+    #ifdef LATENCY_STATS
+    lat_state = LAT_IDLE;   // not a press
+    #endif
+    return 1;
+}
+#endif
+
+#ifdef OSC_CALIBRATION
+/**
+ * !@brief Calibrate INTOSC by the RTC (see osccal.h)
+ *
+ * The alarm that pulls /INT LO meanwhile is taken by the loop, which
+ * doesn't sleep before the pump it started is off. With RELAY_IN_ISR the
+ * relay is turned on here for the masked interrupt.
+ * MINUTE_CLOCK gets the timer of the RTC back.
+ * @param[in] windows Windows to measure
+ */
+void osc_proc(char windows)
+{
+    osc_due = 0;
+    osc_calibrate(RTCINTPIN, windows);
+    #ifdef MINUTE_CLOCK
+    rtc_start_repeated_timer(RTC_TIMER_1MIN, 1);
+    #endif
+    if ((PORTA & RTCINTPIN) == 0) {
+        #ifdef RELAY_IN_ISR
+        TMR0IE = 0;
+        poweron_remain = poweron_ticks; // the IOC was off, as the interrupt does
+        RELAY = 1;
+        TMR0IE = 1;
+        #endif
+        interrupted_alarm = 1;
+    }
+    if (interrupted_alarm || RELAY) {
+        button_idle_timer = 0;  // don't sleep before the pump is on or off
+    }
+}
+#endif
+
+#ifdef VALVE_ZONES
+/**
+ * !@brief Open the valve of the zone by the remaining pump time
+ *
+ * A session runs zone_ticks for every zone, zone 1 (P0) first, with one
+ * cycle of the pump relay. The expander is written only when the valve
+ * changes: VALVE_ZONES + 1 bytes a session.
+ */
+void zone_proc(void)
+{
+    unsigned short left;
+    unsigned char valve = 0;        // bit of the open valve
+
+    if (RELAY) {
+        TMR0IE = 0;
+        left = poweron_remain;      // not torn by the timer interrupt
+        TMR0IE = 1;
+        valve = 1 << (VALVE_ZONES - 1);
+        while (left > zone_ticks && valve != 1) {
+            left -= zone_ticks;
+            valve >>= 1;
+        }
+    }
+    gpio_write(~valve);             // active low
+}
+#endif
+
+#ifdef VDD_MONITOR
+/**
+ * !@brief Measure the supply and raise vdd_level
+ *
+ * The level never goes down until reset, a supply recovering after the
+ * pump stops doesn't switch the policy back and forth. Skipped while the
+ * pump runs, it sags the supply.
+ */
+void vdd_check(void)
+{
+    unsigned short v;
+
+    if (RELAY) {
+        return;
+    }
+    v = vdd_read();
+    if (v > VDD_ADC(VDD_EMPTY_MV)) {
+        vdd_level = 2;
+    } else if (v > VDD_ADC(VDD_LOW_MV) && vdd_level == 0) {
+        vdd_level = 1;
+    }
+    #ifdef HEADLESS
+    if (vdd_level != 0 && status != STATUS_RTC_ERROR) {
+        status = STATUS_LOW_BATTERY;
+    }
+    #endif
+}
+#endif
+
+#ifdef RELAY_IN_ISR
+/**
+ * !@brief Set poweron_ticks by poweron_time
+ *
+ * The interrupt of the RTC alarm reads it, so Interrupt-on-Change is
+ * disabled while its two bytes are written.
+ */
+void set_poweron_ticks(void)
+{
+    IOCIE = 0;
+    poweron_ticks = ONE_SEC * (WORD)poweron_time;
+    IOCIE = 1;
+}
+#endif
+
+/**
+ * !@brief Start the pump by the alarm
+ *
+ * If this code placed in interrupt function then program size is too bigger.
+ * (rtc_start_alarm code was dulilicated.)
+ * So this is called from loop() and, with I2C_PRIORITY, from
+ * i2c_urgent_proc() between bytes of the LCD.
+ * With RELAY_IN_ISR the relay was already turned on by the interrupt,
+ * only the alarm of RTC is cleared here.
+ * With SOIL_SENSOR the pump time is shortened or skipped by the moisture.
+ * With VALVE_ZONES the pump runs the time for every zone in one session.
+ */
+void alarm_proc(void)
+{
+    interrupted_alarm = 0;
+    #ifdef I2C_PRIORITY
+    i2c_urgent = 0;
+    #endif
+    #ifdef MINUTE_CLOCK
+    if ((rtc_read_flags() & RTC_AF) == 0) {
+        rtc_clear_timer();      // only the minute of the clock
+        return;
+    }
+    button_idle_timer = 0;      // don't sleep before the pump is on
+    #endif
+    #if defined(VDD_MONITOR) && defined(HEADLESS)
+    vdd_check();                // before the pump loads the supply
+    #endif
+    #ifdef SOIL_SENSOR
+    poweron_remain = soil_run_time(ONE_SEC * (WORD)poweron_time);
+    #ifdef VALVE_ZONES
+    zone_ticks = poweron_remain;
+    poweron_remain = zone_ticks * VALVE_ZONES;
+    #endif
+    RELAY = (poweron_remain != 0);  // skipped if the soil is wet
+    #elif !defined(RELAY_IN_ISR)
+    #ifdef VALVE_ZONES
+    zone_ticks = ONE_SEC * (WORD)poweron_time;
+    poweron_remain = zone_ticks * VALVE_ZONES;
+    #else
+    poweron_remain = ONE_SEC * (WORD)poweron_time;
+    #endif
+    RELAY = 1;
+    #endif
+    #ifdef VALVE_ZONES
+    zone_proc();                // the valve of the first zone
+    #endif
+    #ifdef UART_TELEMETRY
+    pump_runs++;
+    #endif
+    #ifdef OSC_CALIBRATION
+    osc_due = 1;                // after the pump, before the sleep
+    #endif
+    rtc_start_alarm();
+}
+
+#ifdef I2C_PRIORITY
+/**
+ * !@brief Urgent work of i2c_yield(): start the pump by the alarm
+ */
+void i2c_urgent_proc(void)
+{
+    alarm_proc();
+}
+#endif
 
 
 /**
@@ -275,6 +1029,7 @@ void main(void)
     loop();
 }
 
+#ifndef HEADLESS
 /**
  * !@brief Button press function for showing mode
  */
@@ -282,6 +1037,16 @@ void press_proc_for_showing(char next_mode, char next_set_mode, unsigned char va
 {
     if (button_pressed_state & SW1) {
         mode = next_mode;
+        #ifdef INCREMENTAL_CLOCK
+        if (next_mode == SHOW_CLOCK) {
+            shown_time[0] = 0xff;   // redraw all on the cleared screen
+        }
+        #endif
+        #ifdef LATENCY_STATS
+        if (next_mode == SHOW_LATENCY) {
+            mode_ram.latency.page = 0;
+        }
+        #endif
         lcd_clear();
     } else if (button_long_pressed_state & SW2) {
         mode = next_set_mode;
@@ -298,6 +1063,11 @@ void press_proc_for_setting(char next_mode, char next_value)
     if (button_pressed_state & SW2) {
         mode = next_mode;
         setting_value = next_value;
+        #ifdef INCREMENTAL_CLOCK
+        if (next_mode == SHOW_CLOCK) {
+            shown_time[0] = 0xff;   // redraw all on the cleared screen
+        }
+        #endif
         lcd_clear();
     }
 }
@@ -307,14 +1077,85 @@ void press_proc_for_setting(char next_mode, char next_value)
  */
 void show_clock(void)
 {
+    #ifdef INCREMENTAL_CLOCK
+    unsigned short dirty;
+    #endif
+
+    #ifdef VDD_MONITOR
+    if (refresh_count++ & refresh_mask[vdd_level]) {
+        press_proc_for_showing(SHOW_ALARM, SET_CLOCK_DATE_YEAR, current_time[6]);
+        return;     // keep the last screen
+    }
+    #endif
     // Read the datetime from RTC module
     rtc_read_time(current_time);
+    #ifdef MINUTE_CLOCK
+    current_time[0] = 0;    // hh:mm only, the seconds never change
+    #endif
+#ifdef INCREMENTAL_CLOCK
+    dirty = rtc_update_string(current_time, shown_time, buf);
+    #ifdef MINUTE_CLOCK
+    buf[14] = '\0';
+    #endif
+    #ifdef STATUS_ICONS
+    if (set_status_icon()) {
+        dirty |= 1;
+    }
+    #endif
+    if (dirty == 0xffff) {
+        display(&buf[0], &buf[9]);
+    } else if (lcd_put_cells(0, &buf[0], dirty) != 0 ||
+               lcd_put_cells(1, &buf[9], dirty >> 8) != 0) {
+        shown_time[0] = 0xff;   // redraw all at next time
+    }
+    #ifdef LATENCY_STATS
+    else {
+        latency_proc(&buf[0], &buf[9]);
+    }
+    #endif
+#else
     rtc_time_to_string(current_time, buf);
+    #ifdef MINUTE_CLOCK
+    buf[14] = '\0';
+    #endif
+    #ifdef STATUS_ICONS
+    set_status_icon();
+    #endif
 
     display(&buf[0], &buf[9]);
+#endif
     press_proc_for_showing(SHOW_ALARM, SET_CLOCK_DATE_YEAR, current_time[6]); // 6 means year
 }
 
+#ifdef STATUS_ICONS
+/**
+ * !@brief Put the status icon on the first column of the clock
+ *
+ * The icon replaces the '2' of the year. The pump icon has priority,
+ * then the low battery (VDD_MONITOR).
+ * @return 1:the column was changed 0:not changed
+ */
+char set_status_icon(void)
+{
+    char c = '2';
+
+    if (RELAY) {
+        c = lcd_glyph(ICON_PUMP, icon_pump);
+    #ifdef VDD_MONITOR
+    } else if (vdd_level != 0) {
+        c = lcd_glyph(ICON_BATTERY, icon_battery);
+    #endif
+    } else if (use_alarm) {
+        c = lcd_glyph(ICON_ALARM, icon_alarm);
+    }
+    if (buf[0] == c) {
+        return 0;
+    }
+    buf[0] = c;
+    return 1;
+}
+#endif
+
 /**
  * !@brief Display lines to LCD display
  */
@@ -325,6 +1166,9 @@ void display(const char *first_line, char *second_line)
     lcd_set_cursor(0, 1);
     lcd_puts(second_line);
     lcd_hide_cursor();
+    #ifdef LATENCY_STATS
+    latency_proc(first_line, second_line);
+    #endif
 }
 
 /**
@@ -380,7 +1224,7 @@ void show_alarm(void)
     char *pt;
     if (use_alarm != 0) {
         make_alarm_str();
-        pt = buf;
+        pt = mode_ram.text;
     } else {
         pt = (char*)on_off_str[0];
     }
@@ -390,9 +1234,9 @@ void show_alarm(void)
 
 void make_alarm_str(void)
 {
-    set_ctime(alarm_time[1], '\0', &buf[0]);  // hour
-    set_ctime(alarm_time[0], ':',  &buf[2]);  // min
-    buf[5] = '\0';
+    set_ctime(alarm_time[1], '\0', &mode_ram.text[0]);  // hour
+    set_ctime(alarm_time[0], ':',  &mode_ram.text[2]);  // min
+    mode_ram.text[5] = '\0';
 }
 
 void set_use_alarm(void) {
@@ -424,7 +1268,7 @@ void set_alarm_time(char set_pos) {
     const set_alarm_time_t *ad = &alarm_time_datas[set_pos];
     alarm_time[ad->at_pos] = choose_value(0, ad->max);
     make_alarm_str();
-    display("ALARM?", buf);
+    display("ALARM?", mode_ram.text);
     show_cursor(ad->cursor_pos);
     press_proc_for_setting(ad->next_mode, alarm_time[ad->next_at_pos]);
     if (mode == SHOW_ALARM) {
@@ -436,24 +1280,127 @@ void set_alarm_time(char set_pos) {
 void show_pon_time(void)
 {
     make_pon_str();
-    display("PON", buf);
+    display("PON", mode_ram.text);
+    #ifdef LATENCY_STATS
+    press_proc_for_showing(SHOW_LATENCY, SET_PON_TIME, poweron_time);
+    #else
     press_proc_for_showing(SHOW_CLOCK, SET_PON_TIME, poweron_time);
+    #endif
 }
 
 void set_pon_time(void)
 {
     poweron_time = choose_value(1, 99);
+    #ifdef RELAY_IN_ISR
+    set_poweron_ticks();
+    #endif
     make_pon_str();
-    display("PON?", buf);
+    display("PON?", mode_ram.text);
     show_cursor(1);
     press_proc_for_setting(SHOW_PON_TIME, 0);
 }
 
 void make_pon_str(void)
 {
-    set_ctime(poweron_time, '\0', buf);
-    buf[2] = 's';
-    buf[3] = 'e';
-    buf[4] = 'c';
-    buf[5] = '\0';
+    set_ctime(poweron_time, '\0', mode_ram.text);
+    mode_ram.text[2] = 's';
+    mode_ram.text[3] = 'e';
+    mode_ram.text[4] = 'c';
+    mode_ram.text[5] = '\0';
+}
+
+#ifdef LATENCY_STATS
+/**
+ * !@brief Show the presses of a bucket of the latency histogram
+ *
+ * SW2 shows the next bucket, SW2 long press clears the histogram.
+ */
+void show_latency(void)
+{
+    unsigned char n = latency_hist[mode_ram.latency.page];
+    char *pt = mode_ram.latency.count;
+
+    pt[0] = pt[1] = '0';
+    while (n >= 100) {
+        n -= 100;
+        pt[0]++;
+    }
+    while (n >= 10) {
+        n -= 10;
+        pt[1]++;
+    }
+    pt[2] = '0' + n;
+    pt[3] = '\0';
+    display(latency_label[mode_ram.latency.page], pt);
+    if (button_pressed_state & SW2) {
+        if (++mode_ram.latency.page == LATENCY_BUCKETS) {
+            mode_ram.latency.page = 0;
+        }
+    } else if (button_long_pressed_state & SW2) {
+        for (char i = 0; i < LATENCY_BUCKETS; i++) {
+            latency_hist[i] = 0;
+        }
+    }
+    press_proc_for_showing(SHOW_CLOCK, SHOW_LATENCY, 0);
+}
+
+/**
+ * !@brief Count the press in the histogram when its screen was drawn
+ *
+ * Called after every screen was sent to the LCD. A taken press is counted
+ * by the first screen that differs from lat_shown (like the simulator, a
+ * press changing nothing waits for the clock), a waking one by the first
+ * screen. The time is of Timer0, the interrupts since the edge and TMR0
+ * (128us).
+ * @param[in] first_line Characters of the first line
+ * @param[in] second_line Characters of the second line
+ */
+void latency_proc(const char *first_line, const char *second_line)
+{
+    unsigned short t;
+    unsigned char b;
+    unsigned char h = mode;     // the screen was cleared for a new mode
+
+    while (*first_line) {
+        h = ((h << 1) | (h >> 7)) + *first_line++;
+    }
+    while (*second_line) {
+        h = ((h << 1) | (h >> 7)) + *second_line++;
+    }
+    lat_screen = h;
+    if (lat_state != LAT_SEEN && (lat_state != LAT_TAKEN || h == lat_shown)) {
+        return;
+    }
+    TMR0IE = 0;
+    t = (unsigned short)lat_ticks * (256 - T0CNT) + TMR0 - lat_tmr0;
+    if (TMR0IF) {
+        t += 256 - T0CNT;   // the overflow not counted yet
+    }
+    TMR0IE = 1;
+    lat_state = LAT_IDLE;
+    t >>= LATENCY_SHIFT;
+    for (b = 0; t != 0 && b < LATENCY_BUCKETS - 1; b++) {
+        t >>= 1;
+    }
+    if (latency_hist[b] != 0xff) {
+        latency_hist[b]++;
+    }
+}
+
+/**
+ * !@brief Copy the histogram to EEPROM before SLEEP()
+ *
+ * Only changed bytes are written, a programmer reads them at EE_LATENCY.
+ * A press not drawn yet is dropped, the wake up starts another.
+ */
+void latency_save(void)
+{
+    for (char i = 0; i < LATENCY_BUCKETS; i++) {
+        if (eeprom_read(EE_LATENCY + i) != latency_hist[i]) {
+            eeprom_write(EE_LATENCY + i, latency_hist[i]);
+        }
+    }
+    lat_state = LAT_IDLE;
 }
+#endif
+#endif
@@ -41,11 +41,11 @@ OBJECTDIR=build/${CND_CONF}/${IMAGE_TYPE}
 DISTDIR=dist/${CND_CONF}/${IMAGE_TYPE}
 
 # Object Files Quoted if spaced
-OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/button.p1 ${OBJECTDIR}/i2c.p1 ${OBJECTDIR}/lcd_aqm0802a.p1 ${OBJECTDIR}/main.p1 ${OBJECTDIR}/rtc_8564nb.p1
-POSSIBLE_DEPFILES=${OBJECTDIR}/button.p1.d ${OBJECTDIR}/i2c.p1.d ${OBJECTDIR}/lcd_aqm0802a.p1.d ${OBJECTDIR}/main.p1.d ${OBJECTDIR}/rtc_8564nb.p1.d
+OBJECTFILES_QUOTED_IF_SPACED=${OBJECTDIR}/button.p1 ${OBJECTDIR}/delay.p1 ${OBJECTDIR}/gpio_pcf8574.p1 ${OBJECTDIR}/i2c.p1 ${OBJECTDIR}/lcd_aqm0802a.p1 ${OBJECTDIR}/main.p1 ${OBJECTDIR}/osccal.p1 ${OBJECTDIR}/rtc_8564nb.p1 ${OBJECTDIR}/soil.p1 ${OBJECTDIR}/uart.p1 ${OBJECTDIR}/vdd.p1
+POSSIBLE_DEPFILES=${OBJECTDIR}/button.p1.d ${OBJECTDIR}/delay.p1.d ${OBJECTDIR}/gpio_pcf8574.p1.d ${OBJECTDIR}/i2c.p1.d ${OBJECTDIR}/lcd_aqm0802a.p1.d ${OBJECTDIR}/main.p1.d ${OBJECTDIR}/osccal.p1.d ${OBJECTDIR}/rtc_8564nb.p1.d ${OBJECTDIR}/soil.p1.d ${OBJECTDIR}/uart.p1.d ${OBJECTDIR}/vdd.p1.d
 
 # Object Files
-OBJECTFILES=${OBJECTDIR}/button.p1 ${OBJECTDIR}/i2c.p1 ${OBJECTDIR}/lcd_aqm0802a.p1 ${OBJECTDIR}/main.p1 ${OBJECTDIR}/rtc_8564nb.p1
+OBJECTFILES=${OBJECTDIR}/button.p1 ${OBJECTDIR}/delay.p1 ${OBJECTDIR}/gpio_pcf8574.p1 ${OBJECTDIR}/i2c.p1 ${OBJECTDIR}/lcd_aqm0802a.p1 ${OBJECTDIR}/main.p1 ${OBJECTDIR}/osccal.p1 ${OBJECTDIR}/rtc_8564nb.p1 ${OBJECTDIR}/soil.p1 ${OBJECTDIR}/uart.p1 ${OBJECTDIR}/vdd.p1
 
 
 CFLAGS=
@@ -75,6 +75,20 @@ ${OBJECTDIR}/button.p1: button.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/button.d ${OBJECTDIR}/button.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/button.p1.d $(SILENT) 
 	
+${OBJECTDIR}/delay.p1: delay.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/delay.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/delay.p1  delay.c 
+	@-${MV} ${OBJECTDIR}/delay.d ${OBJECTDIR}/delay.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/delay.p1.d $(SILENT) 
+	
+${OBJECTDIR}/gpio_pcf8574.p1: gpio_pcf8574.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/gpio_pcf8574.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/gpio_pcf8574.p1  gpio_pcf8574.c 
+	@-${MV} ${OBJECTDIR}/gpio_pcf8574.d ${OBJECTDIR}/gpio_pcf8574.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/gpio_pcf8574.p1.d $(SILENT) 
+	
 ${OBJECTDIR}/i2c.p1: i2c.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
 	@${RM} ${OBJECTDIR}/i2c.p1.d 
@@ -96,6 +110,13 @@ ${OBJECTDIR}/main.p1: main.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/main.d ${OBJECTDIR}/main.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/main.p1.d $(SILENT) 
 	
+${OBJECTDIR}/osccal.p1: osccal.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/osccal.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/osccal.p1  osccal.c 
+	@-${MV} ${OBJECTDIR}/osccal.d ${OBJECTDIR}/osccal.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/osccal.p1.d $(SILENT) 
+	
 ${OBJECTDIR}/rtc_8564nb.p1: rtc_8564nb.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
 	@${RM} ${OBJECTDIR}/rtc_8564nb.p1.d 
@@ -103,6 +124,27 @@ ${OBJECTDIR}/rtc_8564nb.p1: rtc_8564nb.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/rtc_8564nb.d ${OBJECTDIR}/rtc_8564nb.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/rtc_8564nb.p1.d $(SILENT) 
 	
+${OBJECTDIR}/soil.p1: soil.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/soil.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/soil.p1  soil.c 
+	@-${MV} ${OBJECTDIR}/soil.d ${OBJECTDIR}/soil.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/soil.p1.d $(SILENT) 
+	
+${OBJECTDIR}/uart.p1: uart.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/uart.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/uart.p1  uart.c 
+	@-${MV} ${OBJECTDIR}/uart.d ${OBJECTDIR}/uart.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/uart.p1.d $(SILENT) 
+	
+${OBJECTDIR}/vdd.p1: vdd.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/vdd.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  -D__DEBUG=1 --debugger=pickit2  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/vdd.p1  vdd.c 
+	@-${MV} ${OBJECTDIR}/vdd.d ${OBJECTDIR}/vdd.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/vdd.p1.d $(SILENT) 
+	
 else
 ${OBJECTDIR}/button.p1: button.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
@@ -111,6 +153,20 @@ ${OBJECTDIR}/button.p1: button.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/button.d ${OBJECTDIR}/button.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/button.p1.d $(SILENT) 
 	
+${OBJECTDIR}/delay.p1: delay.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/delay.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/delay.p1  delay.c 
+	@-${MV} ${OBJECTDIR}/delay.d ${OBJECTDIR}/delay.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/delay.p1.d $(SILENT) 
+	
+${OBJECTDIR}/gpio_pcf8574.p1: gpio_pcf8574.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/gpio_pcf8574.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/gpio_pcf8574.p1  gpio_pcf8574.c 
+	@-${MV} ${OBJECTDIR}/gpio_pcf8574.d ${OBJECTDIR}/gpio_pcf8574.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/gpio_pcf8574.p1.d $(SILENT) 
+	
 ${OBJECTDIR}/i2c.p1: i2c.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
 	@${RM} ${OBJECTDIR}/i2c.p1.d 
@@ -132,6 +188,13 @@ ${OBJECTDIR}/main.p1: main.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/main.d ${OBJECTDIR}/main.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/main.p1.d $(SILENT) 
 	
+${OBJECTDIR}/osccal.p1: osccal.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/osccal.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/osccal.p1  osccal.c 
+	@-${MV} ${OBJECTDIR}/osccal.d ${OBJECTDIR}/osccal.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/osccal.p1.d $(SILENT) 
+	
 ${OBJECTDIR}/rtc_8564nb.p1: rtc_8564nb.c  nbproject/Makefile-${CND_CONF}.mk
 	@${MKDIR} ${OBJECTDIR} 
 	@${RM} ${OBJECTDIR}/rtc_8564nb.p1.d 
@@ -139,6 +202,27 @@ ${OBJECTDIR}/rtc_8564nb.p1: rtc_8564nb.c  nbproject/Makefile-${CND_CONF}.mk
 	@-${MV} ${OBJECTDIR}/rtc_8564nb.d ${OBJECTDIR}/rtc_8564nb.p1.d 
 	@${FIXDEPS} ${OBJECTDIR}/rtc_8564nb.p1.d $(SILENT) 
 	
+${OBJECTDIR}/soil.p1: soil.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/soil.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/soil.p1  soil.c 
+	@-${MV} ${OBJECTDIR}/soil.d ${OBJECTDIR}/soil.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/soil.p1.d $(SILENT) 
+	
+${OBJECTDIR}/uart.p1: uart.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/uart.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/uart.p1  uart.c 
+	@-${MV} ${OBJECTDIR}/uart.d ${OBJECTDIR}/uart.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/uart.p1.d $(SILENT) 
+	
+${OBJECTDIR}/vdd.p1: vdd.c  nbproject/Makefile-${CND_CONF}.mk
+	@${MKDIR} ${OBJECTDIR} 
+	@${RM} ${OBJECTDIR}/vdd.p1.d 
+	${MP_CC} --pass1 $(MP_EXTRA_CC_PRE) --chip=$(MP_PROCESSOR_OPTION) -Q -G --asmlist  --double=24 --float=24 --emi=wordwrite --opt=default,+asm,-asmfile,+speed,-space,-debug,9 --addrqual=ignore -P -N255 --warn=0 --summary=default,-psect,-class,+mem,-hex,-file --runtime=default,+clear,+init,-keep,-no_startup,+osccal,-resetbits,-download,-stackcall,+config,+clib,+plib "--errformat=%f:%l: error: %s" "--warnformat=%f:%l: warning: %s" "--msgformat=%f:%l: advisory: %s"  -o${OBJECTDIR}/vdd.p1  vdd.c 
+	@-${MV} ${OBJECTDIR}/vdd.d ${OBJECTDIR}/vdd.p1.d 
+	@${FIXDEPS} ${OBJECTDIR}/vdd.p1.d $(SILENT) 
+	
 endif
 
 # ------------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Calibration of INTOSC by the crystal of the RTC (see osccal.h)
+
+#include "hal.h"
+#include "rtc_8564nb.h"
+#include "osccal.h"
+
+#ifdef OSC_CALIBRATION
+
+#define OSCCAL_TIMEOUT  0xffff
+
+static signed char osc_tune;        // OSCTUNE (-32 to 31)
+
+/**
+ * !@brief Wait for the falling edge of /INT and restart Timer1
+ *
+ * @param[in] int_pin Bit of RTC /INT in PORTA
+ * @return Timer1 count from the last restart, OSCCAL_TIMEOUT on overflow
+ */
+static unsigned short osc_wait_edge(unsigned char int_pin)
+{
+    unsigned short count;
+
+    while ((PORTA & int_pin) != 0) {
+        if (TMR1IF) {
+            return OSCCAL_TIMEOUT;  // no pulse in 262ms
+        }
+        HAL_POLL();
+    }
+    T1CONbits.TMR1ON = 0;
+    count = ((unsigned short)TMR1H << 8) | TMR1L;
+    TMR1H = 0;
+    TMR1L = 0;
+    T1CONbits.TMR1ON = 1;
+    return count;
+}
+
+/**
+ * !@brief Step OSCTUNE by the count of a window
+ *
+ * The count changes about OSCCAL_STEP by a step, no division.
+ */
+static void osc_trim(unsigned short count)
+{
+    signed char t = osc_tune;
+
+    while (count > OSCCAL_TARGET + OSCCAL_STEP / 2 && t > -32) {
+        t--;
+        count -= OSCCAL_STEP;
+    }
+    while (count < OSCCAL_TARGET - OSCCAL_STEP / 2 && t < 31) {
+        t++;
+        count += OSCCAL_STEP;
+    }
+    osc_tune = t;
+    OSCTUNE = t & 0x3f;
+}
+
+/**
+ * !@brief Calibrate INTOSC by the repeated timer of the RTC
+ *
+ * The IOC of /INT is off while the timer runs. It gives up when /INT is
+ * already LO or the alarm ended a window, the alarm flag is kept and
+ * the caller checks /INT afterwards.
+ * @param[in] int_pin Bit of RTC /INT in PORTA
+ * @param[in] windows Windows to measure (a window is 125ms)
+ * @return 0:success others:failure
+ */
+char osc_calibrate(unsigned char int_pin, char windows)
+{
+    unsigned short count;
+    char result = 1;
+
+    IOCAN = IOCAN & ~int_pin;
+    T1CON = 0b00110000;             // Fosc/4, 1:8
+    TMR1H = 0;
+    TMR1L = 0;
+    TMR1IF = 0;
+    T1CONbits.TMR1ON = 1;
+    if (rtc_start_repeated_timer(RTC_TIMER_64HZ, OSCCAL_WINDOW_COUNT) == 0 &&
+        (PORTA & int_pin) != 0 && osc_wait_edge(int_pin) != OSCCAL_TIMEOUT) {
+        for (; windows != 0; windows--) {
+            TMR1IF = 0;
+            rtc_clear_timer();      // /INT goes HI
+            count = osc_wait_edge(int_pin);
+            if (count < OSCCAL_TARGET - OSCCAL_RANGE || OSCCAL_TARGET + OSCCAL_RANGE < count) {
+                break;              // timeout or the alarm
+            }
+            if (rtc_read_flags() & RTC_AF) {
+                break;              // the alarm late in the window
+            }
+            osc_trim(count);
+        }
+        result = windows;
+    }
+    T1CON = 0;
+    rtc_stop_repeated_timer();
+    IOCAF = IOCAF & ~int_pin;
+    IOCAN = IOCAN | int_pin;
+    return result;
+}
+#endif
@@ -0,0 +1,44 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+#ifndef _OSCCAL_H_
+#define _OSCCAL_H_
+
+// Calibration of INTOSC by the crystal of the RTC
+//  - The repeated timer of the RTC pulls /INT LO every OSCCAL_WINDOW_COUNT
+//    of 15.625ms (125ms). Timer1 counts Fosc/4 with 1:8 between the
+//    falling edges and OSCTUNE is stepped toward OSCCAL_TARGET.
+//  - main.c runs it at start up and once after every alarm (the pump is
+//    off), so the drift by the temperature and the supply is followed.
+//  - The RTC timer is used, MINUTE_CLOCK restarts it afterwards.
+
+//#define OSC_CALIBRATION // Trim INTOSC by the RTC at start up and after the alarm
+
+#define OSCCAL_WINDOW_COUNT 8       // RTC timer count of a window (125ms)
+#define OSCCAL_TARGET   31250U      // Timer1 count of a window at 8MHz
+#define OSCCAL_STEP     109         // Timer1 count of an OSCTUNE step (about 0.35%)
+#define OSCCAL_RANGE    (OSCCAL_TARGET / 8) // a window further off is not the timer
+#define OSCCAL_BOOT     3           // windows at start up (coarse, fine, check)
+#define OSCCAL_TRACK    1           // windows after the alarm
+
+char osc_calibrate(unsigned char int_pin, char windows);
+
+#endif
@@ -0,0 +1,46 @@
+#!/bin/sh
+#
+# Check the RAM usage in the map file of XC8
+#
+#  usage: ramcheck.sh <.map> [budget]
+#
+#  Sums the psects of the data space (COMMON, BANKn, ABS1) and fails when
+#  the total exceeds the budget in bytes (default 120 of 128).
+#
+
+[ $# -ge 1 ] || { echo "usage: $0 <map> [budget]" >&2; exit 2; }
+[ -f "$1" ] || { echo "$0: $1: not found" >&2; exit 2; }
+
+awk -v budget="${2:-120}" '
+function hex(s,    i, v) {
+    v = 0
+    for (i = 1; i <= length(s); i++) {
+        v = v * 16 + index("0123456789ABCDEF", toupper(substr(s, i, 1))) - 1
+    }
+    return v
+}
+# "TOTAL  Name  Link  Load  Length  Space" lists psects by class
+$1 == "TOTAL" { total = 1; next }
+$1 == "SEGMENTS" { total = 0 }
+total && $1 == "CLASS" {
+    class = ($2 == "COMMON" || $2 == "ABS1" || $2 ~ /^BANK[0-9]+$/) ? $2 : ""
+    next
+}
+total && class != "" && NF == 5 && $5 == 1 {
+    used[class] += hex($4)
+    if (!(class in order)) {
+        order[class] = ++n
+        names[n] = class
+    }
+}
+END {
+    for (i = 1; i <= n; i++) {
+        printf "%-8s %3d bytes\n", names[i], used[names[i]]
+        sum += used[names[i]]
+    }
+    printf "RAM      %3d bytes (budget %d)\n", sum, budget
+    if (sum > budget) {
+        print "RAM budget exceeded" > "/dev/stderr"
+        exit 1
+    }
+}' "$1"
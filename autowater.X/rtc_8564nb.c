@@ -27,9 +27,10 @@
 //  - Note: This module has the feature of 'day of week',
 //          but this code isn't use that.
 
-#include <xc.h>
+#include "hal.h"
 #include <string.h>
 #include "i2c.h"
+#include "delay.h"
 #include "rtc_8564nb.h"
 
 // define
@@ -45,27 +46,79 @@ int  rtc_pinmask;
 /**
  * !@brief Convert BCD to number
  *
+ * Every byte gives (dt >> 4) * 10 + (dt & 0xf), also 0xff of an I2C error.
  * @param[in] dt BCD value
  * @return converted number
  */
 unsigned char bcd2bin(unsigned char dt)
 {
+#if BCD_KERNEL == BCD_KERNEL_TABLE
+    static const unsigned char tens[16] = {0, 10, 20, 30, 40, 50, 60, 70, 80, 90,
+                                           100, 110, 120, 130, 140, 150};
+    return tens[dt >> 4] + (dt & 0xf);
+#elif BCD_KERNEL == BCD_KERNEL_DABBLE
+    // reverse double dabble: shift out to the right and
+    // subtract 3 from the ones digit when it is 8 or more
+    // (8 bits for the tens digit over 9, 0xff => 165)
+    unsigned char num = 0;
+    unsigned char i;
+    for (i=0; i<8; i++) {
+        num = (num >> 1) | ((dt & 1) << 7);
+        dt >>= 1;
+        if ((dt & 0x0f) >= 8) {
+            dt -= 3;
+        }
+    }
+    return num;
+#else
     //return ((dt >> 4) * 10) + (dt & 0xf);
 
     // same as below code
     // 10 == 2 + 8 == (1<<1) + (1<<3)
     unsigned char a = (dt >> 4);
     return (a << 1) + (a << 3) + (dt & 0xf);
+#endif
 }
 
 /**
  * !@brief Convert number to BCD value
  *
  * @param[in] number. This value is in the range of 0..99.
- * @return BCD value
+ * @return BCD value (others give a wrong value, but no table is read out of range)
  */
 unsigned char bin2bcd(unsigned char num)
 {
+#if BCD_KERNEL == BCD_KERNEL_TABLE
+    // num == 16 * hi + lo, add BCD(16 * hi) and BCD(lo) with decimal adjust
+    // (the entries over 99 are for num >= 112, the hundreds dropped)
+    static const unsigned char hi[16] = {0x00, 0x16, 0x32, 0x48, 0x64, 0x80, 0x96, 0x12,
+                                         0x28, 0x44, 0x60, 0x76, 0x92, 0x08, 0x24, 0x40};
+    unsigned char a = hi[num >> 4];
+    unsigned char b = num & 0x0f;
+    unsigned char s;
+    if (b >= 10) {
+        b += 6;
+    }
+    s = a + b;
+    if ((s & 0x0f) >= 10 || (s & 0x0f) < (a & 0x0f)) {
+        s += 6;
+    }
+    return s;
+#elif BCD_KERNEL == BCD_KERNEL_DABBLE
+    // double dabble: add 3 to the ones digit when it is 5 or more
+    // and shift in from the left. The tens digit never reaches 5 for 0..99.
+    unsigned char bcd = 0;
+    unsigned char i;
+    num <<= 1;
+    for (i=0; i<7; i++) {
+        if ((bcd & 0x0f) >= 5) {
+            bcd += 3;
+        }
+        bcd = (bcd << 1) | (num >> 7);
+        num <<= 1;
+    }
+    return bcd;
+#else
     //return ((num / 10) << 4) | (num%10);
 
     // same as blow code
@@ -75,6 +128,7 @@ unsigned char bin2bcd(unsigned char num)
     unsigned char a = s >> 11;
     unsigned char b = (a << 1) + (a << 3); // == a * 10
     return (a << 4) | (num - b);
+#endif
 }
 
 /**
@@ -85,7 +139,7 @@ unsigned char bin2bcd(unsigned char num)
  */
 void delay_1000ms(void)
 {
-    __delay_ms(1000);
+    delay_ms(1000);
 }
 
 
@@ -197,11 +251,11 @@ int rtc_init(char *tm)
         i2c_rstart(RTC_ADDR, RW_0);
         i2c_send(0x00);                 // Set the register address to 00h
         i2c_send(0x00);                 // Set Control1 (TEST=0,STOP=0)
-        i2c_stop();
+        ret = i2c_stop();
         delay_1000ms();
     } else {
         rtc_ctrl2 = reg1;
-        i2c_stop();
+        ret = i2c_stop();
     }
 
     #ifdef USE_CLOCKOUT
@@ -248,10 +302,10 @@ int rtc_set_time(char *tm)
         i2c_rstart(RTC_ADDR,RW_0);      // Set repeated start condition
         i2c_send(0x00);                 // Set the register address to 02h
         i2c_send(0x00);                 // Set Control1 (TEST=0,STOP=0)
-        i2c_stop();
+        ret = i2c_stop();
         delay_1000ms();
     } else {
-        i2c_stop();
+        ret |= i2c_stop();
     }
     return ret;
 }
@@ -284,7 +338,7 @@ int rtc_read_time(char *tm)
         }
         *tm = bcd2bin(i2c_receive(NOACK));  // year
     }
-    i2c_stop();
+    ret |= i2c_stop();
     return ret;
 }
 
@@ -293,11 +347,25 @@ int rtc_read_time(char *tm)
  *
  * @param[in] tm Date value that formatted RTC module value
  * @param[out] c The address of string to output. formatted below.
- *             "yyyymmdd\0hh:mm:ss\0"
- *             e.g. "20110531\013:29:20\0"
+ *             "yyyymmdd hh:mm:ss\0"
+ *             e.g. "20110531 13:29:20\0"
  */
 void rtc_time_to_string(char *tm, char *c)
 {
+#ifdef SHARED_EMITTER
+    // output position and prefix of sec, min, hour, day, weekday, month, year
+    static const unsigned char pos[7] = {14, 11, 8, 6, 0xff, 4, 1};
+    static const char prefix[7] = {':', ':', ' ', '\0', '\0', '\0', '0'};
+    unsigned char i;
+
+    c[17] = '\0';
+    for (i=0; i<7; i++) {
+        if (pos[i] != 0xff) {
+            set_ctime(tm[i], prefix[i], &c[pos[i]]);
+        }
+    }
+    c[0] = '2';
+#else
     char *buf = c;
 
     //20110531\013:29:20\0
@@ -315,6 +383,56 @@ void rtc_time_to_string(char *tm, char *c)
     tm++;
     set_ctime(*tm, '0', &buf[1]);   // year
     buf[0] = '2';
+#endif
+}
+
+/**
+ * !@brief Update only the digits of changed fields in the string
+ *
+ * Same layout as rtc_time_to_string(). Fields equal to the last values are
+ * skipped and only digits that differ from the string are written.
+ * Set last[0] to 0xff to build the whole string again (e.g. after clear).
+ *
+ * @param[in] tm Date value that formatted RTC module value
+ * @param[in,out] last Values of the string. Updated to tm.
+ * @param[in,out] c The string made by rtc_time_to_string()
+ * @return Cells changed. bit0-7 => c[0]..c[7] (first line)
+ *                        bit8-15 => c[9]..c[16] (second line)
+ */
+unsigned short rtc_update_string(char *tm, char *last, char *c)
+{
+    // position of tens digit of sec, min, hour, day, weekday, month, year
+    static const unsigned char pos[7] = {15, 12, 9, 6, 0, 4, 2};
+    unsigned short dirty = 0;
+    unsigned char i, p, bcd, d;
+
+    if (last[0] == (char)0xff) {
+        rtc_time_to_string(tm, c);
+        for (i=0; i<7; i++) {
+            last[i] = tm[i];
+        }
+        return 0xffff;
+    }
+    for (i=0; i<7; i++) {
+        p = pos[i];
+        if (p == 0 || tm[i] == last[i]) {
+            continue;
+        }
+        last[i] = tm[i];
+        bcd = bin2bcd(tm[i]);
+        d = (bcd >> 4) + 0x30;
+        if (c[p] != d) {
+            c[p] = d;
+            dirty |= (unsigned short)1 << (p < 8 ? p : p - 1);
+        }
+        p++;
+        d = (bcd & 0x0f) + 0x30;
+        if (c[p] != d) {
+            c[p] = d;
+            dirty |= (unsigned short)1 << (p < 8 ? p : p - 1);
+        }
+    }
+    return dirty;
 }
 
 /**
@@ -339,34 +457,93 @@ void set_ctime(char tm, char prefix, char *out)
 /**
  * !@brief Set repeated timer
  *
+ * TF is set and /INT goes LO every interval until rtc_clear_timer().
  * @param[in] clock Clock interval.
  *                  0:244.14us 1:15.625ms 2:1sec 3:1min
  * @param[in] count Counter value. clock * count => Timer interval.
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_start_repeated_timer(char clock, char count)
+int rtc_start_repeated_timer(char clock, char count)
 {
-    i2c_start(RTC_ADDR, RW_0);
-    i2c_send(0x0f);               // Set the register address to 0Fh
-    i2c_send(count);              // Set Timer(Reg0F) register
-    i2c_rstart(RTC_ADDR, RW_0);
-    i2c_send(0x0e);               // Set the register address to 0Eh
-    i2c_send(clock | 0x80);       // Set TimerControl(Reg0E) register
-    i2c_stop();
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret == 0) {
+        i2c_send(0x0f);               // Set the register address to 0Fh
+        i2c_send(count);              // Set Timer(Reg0F) register
+        i2c_rstart(RTC_ADDR, RW_0);
+        i2c_send(0x0e);               // Set the register address to 0Eh
+        i2c_send(clock | 0x80);       // Set TimerControl(Reg0E) register
+        i2c_rstart(RTC_ADDR, RW_0);
+        i2c_send(0x01);               // Set the register address to 01h
+        rtc_ctrl2 = (rtc_ctrl2 | 0x01) & 0xfb; // Enable timer interrupt (TIE=1 TF=0)
+        i2c_send(rtc_ctrl2 | RTC_AF); // Keep AF (writing 1 doesn't change it)
+    }
+    ret |= i2c_stop();
+    return ret;
+}
+
+/**
+ * !@brief Clear the timer flag
+ *
+ * The timer continues working and AF is kept.
+ * @return Return the result. 0:success others:failure (see i2c.h)
+ */
+int rtc_clear_timer(void)
+{
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret == 0) {
+        i2c_send(0x01);                 // Set the register address to 01h
+        rtc_ctrl2 = rtc_ctrl2 & 0xfb;   // Clear Timer Flag (TF=0)
+        i2c_send(rtc_ctrl2 | RTC_AF);   // Keep AF (writing 1 doesn't change it)
+    }
+    ret |= i2c_stop();
+    return ret;
+}
+
+/**
+ * !@brief Read the flags of the alarm and the timer
+ *
+ * @return Control2(Reg01) register (RTC_AF, RTC_TF). 0 on failure
+ */
+char rtc_read_flags(void)
+{
+    char reg1 = 0;
+
+    if (i2c_start(RTC_ADDR, RW_0) == 0) {
+        i2c_send(0x01);             // Set the register address to 01h
+        i2c_rstart(RTC_ADDR, RW_1);
+        reg1 = i2c_receive(NOACK);  // Receive register from 01h
+    }
+    if (i2c_stop() != 0) {
+        reg1 = 0;
+    }
+    return reg1;
 }
 
 /**
  * !@brief Stop repeated timer.
+ *
+ * AF is kept, an alarm during the timer is still served.
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_stop_repeated_timer(void)
+int rtc_stop_repeated_timer(void)
 {
-    i2c_start(RTC_ADDR, RW_0);
-    i2c_send(0x0e);               // Set the register address to 0Eh
-    i2c_send(0x00);               // Clear TimerControl(Reg0E) register
-    i2c_rstart(RTC_ADDR, RW_0);
-    i2c_send(0x01);               // Set the register address to 0Eh
-    rtc_ctrl2 = rtc_ctrl2 & 0xfb; // Clear the timer flag
-    i2c_send(rtc_ctrl2);          // Set Control2(Reg01) register
-    i2c_stop();
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret == 0) {
+        i2c_send(0x0e);               // Set the register address to 0Eh
+        i2c_send(0x00);               // Clear TimerControl(Reg0E) register
+        i2c_rstart(RTC_ADDR, RW_0);
+        i2c_send(0x01);               // Set the register address to 0Eh
+        rtc_ctrl2 = rtc_ctrl2 & 0xfb; // Clear the timer flag
+        i2c_send(rtc_ctrl2 | RTC_AF); // Keep AF (writing 1 doesn't change it)
+    }
+    ret |= i2c_stop();
+    return ret;
 }
 
 /**
@@ -378,10 +555,17 @@ void rtc_stop_repeated_timer(void)
  *            FULL_ALARM is not defined
  *              tm[0]:minute, tm[1]:hour, tm[2]:day of month , tm[3]:Weekday
  *            Set to 0x80 to disable value.
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_set_alarm(char *tm)
+int rtc_set_alarm(char *tm)
 {
-    i2c_start(RTC_ADDR, RW_0);
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret != 0) {
+        i2c_stop();
+        return ret;
+    }
     i2c_send(0x09);             // Set the register address to 09h
     #ifdef FULL_ALARM
     for (int i=0; i<4; i++)
@@ -400,43 +584,58 @@ void rtc_set_alarm(char *tm)
     i2c_send(0x80); // disable day
     i2c_send(0x80); // disable weekday
     #endif
-    rtc_start_alarm();
+    return rtc_start_alarm();
 }
 
 /**
  * !@brief Start the Alarm
+ *
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_start_alarm(void)
+int rtc_start_alarm(void)
 {
     i2c_rstart(RTC_ADDR, RW_0);
     i2c_send(0x01);               // Set the register address to 01h
     rtc_ctrl2 = (rtc_ctrl2 | 0x02) & 0xf7; // Enable alarm (AIE=1 AF=0)
     i2c_send(rtc_ctrl2);          // Set Control2(Reg01) register
-    i2c_stop();
+    return i2c_stop();
 }
 
 /**
  * !@brief Stop the Alarm
+ *
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_stop_alarm(void)
+int rtc_stop_alarm(void)
 {
-    i2c_start(RTC_ADDR, RW_0);
-    i2c_send(0x01);                 // Set the register address to 01h
-    rtc_ctrl2 = rtc_ctrl2 & 0xf5;   // Disable alarm(AIE=0 AF=0)
-    i2c_send(rtc_ctrl2);            // Set Control2(Reg01) register
-    i2c_stop();
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret == 0) {
+        i2c_send(0x01);                 // Set the register address to 01h
+        rtc_ctrl2 = rtc_ctrl2 & 0xf5;   // Disable alarm(AIE=0 AF=0)
+        i2c_send(rtc_ctrl2);            // Set Control2(Reg01) register
+    }
+    ret |= i2c_stop();
+    return ret;
 }
 
 /**
  * !@brief Clear alarm flag
  *
  * But Alaam continue working.
+ * @return Return the result. 0:success others:failure (see i2c.h)
  */
-void rtc_clear_alarm(void)
+int rtc_clear_alarm(void)
 {
-    i2c_start(RTC_ADDR, RW_0);
-    i2c_send(0x01);                 // Set the register address to 01h
-    rtc_ctrl2 = rtc_ctrl2 & 0xf7;   // Clear Alarm Flag (AF=0)
-    i2c_send(rtc_ctrl2);            // Set Control2(Reg01) register
-    i2c_stop();
+    int ret;
+
+    ret = i2c_start(RTC_ADDR, RW_0);
+    if (ret == 0) {
+        i2c_send(0x01);                 // Set the register address to 01h
+        rtc_ctrl2 = rtc_ctrl2 & 0xf7;   // Clear Alarm Flag (AF=0)
+        i2c_send(rtc_ctrl2);            // Set Control2(Reg01) register
+    }
+    ret |= i2c_stop();
+    return ret;
 }
@@ -39,6 +39,23 @@
 //#define FULL_ALARM      // whether using full alarm
 //#define USE_CLOCKOUT    // Use CLOCKOUT feature
 
+// Implementation of bcd2bin()/bin2bcd() (compared by host/kernels.c)
+#define BCD_KERNEL_MUL      0   // multiply by 205 instead of dividing by 10
+#define BCD_KERNEL_TABLE    1   // nibble lookup table
+#define BCD_KERNEL_DABBLE   2   // double dabble (shift and add 3)
+#ifndef BCD_KERNEL
+#define BCD_KERNEL  BCD_KERNEL_MUL
+#endif
+//#define SHARED_EMITTER  // rtc_time_to_string() loops over a table of fields
+
+// Flags of Control2 register
+#define RTC_AF      0x08    // alarm
+#define RTC_TF      0x04    // timer
+
+// Source clock of rtc_start_repeated_timer()
+#define RTC_TIMER_64HZ  1   // counts every 15.625ms of the crystal
+#define RTC_TIMER_1MIN  3   // counts at the carry to minute
+
 #ifdef USE_CLOCKOUT
 int  rtc_interrupt(void);
 int  rtc_init(char inter, char *tm);
@@ -49,11 +66,14 @@ void set_ctime(char tm, char s, char *a);
 int  rtc_set_time(char *tm);
 int  rtc_read_time(char *tm);
 void rtc_time_to_string(char *tm, char *c);
-void rtc_start_repeated_timer(char clock, char count);
-void rtc_stop_repeated_timer(void);
-void rtc_set_alarm(char *tm);
-void rtc_start_alarm(void);
-void rtc_stop_alarm(void);
-void rtc_clear_alarm(void);
+unsigned short rtc_update_string(char *tm, char *last, char *c);
+int  rtc_start_repeated_timer(char clock, char count);
+int  rtc_stop_repeated_timer(void);
+int  rtc_clear_timer(void);
+char rtc_read_flags(void);
+int  rtc_set_alarm(char *tm);
+int  rtc_start_alarm(void);
+int  rtc_stop_alarm(void);
+int  rtc_clear_alarm(void);
 
 #endif
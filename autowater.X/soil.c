@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Soil-moisture sensor (see soil.h)
+//  - No float and no division at run time: the decimation and the filter
+//    are shifts.
+
+#include "hal.h"
+#include "delay.h"
+#include "soil.h"
+
+#ifdef SOIL_SENSOR
+
+/**
+ * !@brief Initialize the pins and the ADC
+ *
+ * AN3 stays analog so the unpowered sensor doesn't leave a digital input
+ * floating. The ADC is on only while measuring.
+ * The pull-ups of RA4/RA5 must be off (PULLUP_PINS of main.c).
+ */
+void soil_init(void)
+{
+    SOIL_POWER = 0;
+    TRISA  = TRISA & ~SOIL_POWER_BIT;
+    ANSELA = ANSELA | SOIL_ANSEL_BIT;
+    ADCON1 = 0b10010000;                // right justified, Fosc/8 (TAD 1us), VDD
+}
+
+/**
+ * !@brief Measure the soil moisture
+ *
+ * The sensor is powered for SOIL_SETTLE_MS and about 2ms of conversions.
+ * @return Moisture in 12 bits (0-4095)
+ */
+unsigned short soil_measure(void)
+{
+    unsigned short sum;
+    unsigned short y = 0;
+
+    SOIL_POWER = 1;
+    ADCON0 = (SOIL_CHANNEL << 2) | 1;   // AN3, ADON
+    __delay_ms(SOIL_SETTLE_MS);
+    for (char b=0; b<SOIL_BLOCKS; b++) {
+        sum = 0;
+        for (char i=0; i<SOIL_OVERSAMPLE; i++) {
+            __delay_us(5);              // acquisition
+            ADCON0bits.GO_nDONE = 1;
+            while (ADCON0bits.GO_nDONE) {
+                HAL_POLL();
+            }
+            sum += ((unsigned short)ADRESH << 8) | ADRESL;
+        }
+        sum >>= 2;                      // decimate 14 to 12 bits
+        if (b == 0) {
+            y = sum;
+        } else if (sum > y) {
+            y += (sum - y) >> SOIL_IIR_SHIFT;
+        } else {
+            y -= (y - sum) >> SOIL_IIR_SHIFT;
+        }
+    }
+    ADCON0 = 0;
+    SOIL_POWER = 0;
+    return y;
+}
+
+/**
+ * !@brief Pump time by the soil moisture
+ *
+ * @param[in] ticks Full pump time (timer count)
+ * @return Pump time, 0 to skip
+ */
+unsigned short soil_run_time(unsigned short ticks)
+{
+    unsigned short m = soil_measure();
+    char n;
+
+    if (m >= SOIL_WET) {
+        return 0;
+    }
+    n = (char)((SOIL_WET - m) / SOIL_STEP);
+    if (n < 3) {
+        ticks = (ticks >> 2) * (char)(n + 1);
+    }
+    return ticks;
+}
+#endif
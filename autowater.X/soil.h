@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+#ifndef _SOIL_H_
+#define _SOIL_H_
+
+// Soil-moisture sensor
+//  - The sensor is powered by RA5 only while measuring, its output goes to
+//    AN3 (RA4). Both pins are of the switches, so it needs HEADLESS of
+//    main.c, and RTC /INT is wired to RA3.
+//  - The output rises with the moisture (e.g. a resistive probe from RA5
+//    over a resistor to GND). Invert SOIL_WET/SOIL_STEP for a sensor whose
+//    output falls.
+//  - SOIL_BLOCKS blocks of SOIL_OVERSAMPLE conversions. Every block is
+//    decimated to 12 bits and goes through y += (x - y) / 2^SOIL_IIR_SHIFT.
+
+//#define SOIL_SENSOR     // Skip or shorten the pump by the soil moisture
+
+#define SOIL_POWER      RA5     // RA5 powers the sensor
+#define SOIL_POWER_BIT  (1<<5)
+#define SOIL_ANSEL_BIT  (1<<4)  // RA4 is AN3
+#define SOIL_CHANNEL    3       // AN3
+#define SOIL_SETTLE_MS  2       // sensor output settles after power on
+#define SOIL_OVERSAMPLE 16      // conversions per block (4^2: 2 more bits)
+#define SOIL_BLOCKS     8       // blocks per measurement
+#define SOIL_IIR_SHIFT  2       // filter coefficient 1/4
+
+// Thresholds of the 12 bit moisture
+//   >= SOIL_WET                 : the pump is skipped
+//   >= SOIL_WET - 1 * SOIL_STEP : 1/4 of poweron_time
+//   >= SOIL_WET - 2 * SOIL_STEP : 2/4
+//   >= SOIL_WET - 3 * SOIL_STEP : 3/4
+//   others                      : full poweron_time
+#define SOIL_WET        3072
+#define SOIL_STEP       256     // power of 2
+
+#ifdef SOIL_SENSOR
+void soil_init(void);
+unsigned short soil_measure(void);
+unsigned short soil_run_time(unsigned short ticks);
+#endif
+
+#endif
@@ -0,0 +1,214 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// EUSART telemetry and configuration (see uart.h)
+//  - The interrupt only moves bytes between the EUSART and the rings.
+//  - Frames are parsed in the main loop by uart_receive_frame().
+
+#include "hal.h"
+#include "uart.h"
+
+#ifdef UART_TELEMETRY
+#define UART_IDLE_LOOPS 4   // calls without a byte that end the reception
+
+unsigned char uart_tx_buf[UART_TX_SIZE];
+volatile unsigned char uart_tx_head;    // next to put (main)
+volatile unsigned char uart_tx_tail;    // next to send (interrupt)
+unsigned char uart_rx_buf[UART_RX_SIZE];
+volatile unsigned char uart_rx_head;    // next to put (interrupt)
+unsigned char uart_rx_tail;             // next to parse (main)
+unsigned char uart_frame[UART_PAYLOAD]; // payload received or to send
+unsigned char uart_frame_len;           // length of the received payload
+unsigned char uart_bad_frames;          // checksum, length or timeout errors
+unsigned char uart_pos;                 // 0:wait SOF 1:type 2:length 3-:payload
+unsigned char uart_type;
+unsigned char uart_sum;
+volatile unsigned char uart_idle;       // calls left until the reception ends
+
+/**
+ * !@brief Initialize the EUSART
+ *
+ * 9600bps by 8MHz/(4*(207+1)) = 9615bps (BRG16=1, BRGH=1).
+ */
+void uart_init(void)
+{
+    APFCON   = APFCON | 0b10000100; // RX on RA5 (RXDTSEL), TX on RA4 (TXCKSEL)
+    SPBRGH   = 0;
+    SPBRGL   = 207;
+    BAUDCON  = 0b00001000;          // BRG16
+    TXSTA    = 0b00100100;          // TXEN, BRGH, asynchronous 8 bits
+    RCSTA    = 0b10010000;          // SPEN, CREN
+    RCIE     = 1;
+    PEIE     = 1;
+}
+
+/**
+ * !@brief Interrupt handler of the EUSART
+ */
+void uart_interrupt(void)
+{
+    unsigned char next;
+    unsigned char c;
+
+    if (RCIF == 1) {
+        c = RCREG;                          // clears RCIF
+        uart_idle = UART_IDLE_LOOPS;
+        // Bytes out of a frame (e.g. UART_WAKE) aren't kept
+        if (uart_pos != 0 || uart_rx_head != uart_rx_tail || c == UART_SOF) {
+            next = (uart_rx_head + 1) & (UART_RX_SIZE - 1);
+            uart_rx_buf[uart_rx_head] = c;
+            if (next != uart_rx_tail) {
+                uart_rx_head = next;        // dropped when full
+            }
+        }
+        if (RCSTAbits.OERR) {
+            RCSTAbits.CREN = 0;             // clear the overrun
+            RCSTAbits.CREN = 1;
+        }
+    }
+    if (TXIE == 1 && TXIF == 1) {
+        if (uart_tx_tail != uart_tx_head) {
+            TXREG = uart_tx_buf[uart_tx_tail];
+            uart_tx_tail = (uart_tx_tail + 1) & (UART_TX_SIZE - 1);
+        }
+        if (uart_tx_tail == uart_tx_head) {
+            TXIE = 0;
+        }
+    }
+}
+
+/**
+ * !@brief Put a byte to the TX ring, wait while it is full
+ */
+static void uart_putc(unsigned char c)
+{
+    unsigned char next = (uart_tx_head + 1) & (UART_TX_SIZE - 1);
+
+    while (next == uart_tx_tail) {
+        HAL_POLL();
+    }
+    uart_tx_buf[uart_tx_head] = c;
+    uart_tx_head = next;
+    TXIE = 1;
+}
+
+/**
+ * !@brief Send a frame
+ *
+ * Returns when the last bytes are in the ring, the interrupt sends them.
+ * @param[in] type Frame type
+ * @param[in] data Payload
+ * @param[in] len Length of payload
+ */
+void uart_send_frame(char type, const char *data, char len)
+{
+    unsigned char sum = type + len;
+
+    uart_putc(UART_SOF);
+    uart_putc(type);
+    uart_putc(len);
+    for (; len != 0; len--) {
+        sum += *data;
+        uart_putc(*data++);
+    }
+    uart_putc(-sum);
+}
+
+/**
+ * !@brief Parse the received bytes
+ *
+ * Call this every loop. A frame not completed within UART_IDLE_LOOPS calls
+ * without a byte is dropped. The rest of the ring is kept for the next call.
+ * The interrupt doesn't queue bytes out of a frame, so the frame after
+ * UART_WAKE fits in the ring even if the unit was awake.
+ * @return Type of the received frame (payload in uart_frame), 0 if none
+ */
+char uart_receive_frame(void)
+{
+    unsigned char c;
+
+    if (uart_rx_tail == uart_rx_head) {
+        if (uart_idle != 0 && --uart_idle == 0 && uart_pos != 0) {
+            uart_pos = 0;
+            uart_bad_frames++;          // timed out
+        }
+        return 0;
+    }
+    while (uart_rx_tail != uart_rx_head) {
+        c = uart_rx_buf[uart_rx_tail];
+        uart_rx_tail = (uart_rx_tail + 1) & (UART_RX_SIZE - 1);
+        if (uart_pos == 0) {
+            if (c == UART_SOF) {        // others (e.g. UART_WAKE) are skipped
+                uart_sum = 0;
+                uart_pos = 1;
+            }
+            continue;
+        }
+        uart_sum += c;
+        if (uart_pos == 1) {
+            uart_type = c;
+        } else if (uart_pos == 2) {
+            if (c > UART_PAYLOAD) {
+                uart_pos = 0;
+                uart_bad_frames++;
+                continue;
+            }
+            uart_frame_len = c;
+        } else if (uart_pos - 3 < uart_frame_len) {
+            uart_frame[uart_pos - 3] = c;
+        } else {
+            uart_pos = 0;               // checksum
+            if (uart_sum == 0) {
+                return uart_type;
+            }
+            uart_bad_frames++;
+            continue;
+        }
+        uart_pos++;
+    }
+    return 0;
+}
+
+/**
+ * !@brief Whether the EUSART is in use
+ *
+ * @return 1 while sending or receiving a frame (don't sleep), 0 if idle
+ */
+char uart_busy(void)
+{
+    if (uart_idle != 0 || uart_tx_tail != uart_tx_head || TXSTAbits.TRMT == 0) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * !@brief Prepare the EUSART for SLEEP()
+ *
+ * The receiver stops in sleep. The falling edge of the next start bit
+ * wakes up (WUE), that byte is lost.
+ */
+void uart_sleep(void)
+{
+    BAUDCONbits.WUE = 1;
+}
+#endif
@@ -0,0 +1,76 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+#ifndef _UART_H_
+#define _UART_H_
+
+// EUSART telemetry and configuration
+//  - 9600bps 8N1. TX is remapped to RA4 and RX to RA5 (APFCON), so it needs
+//    HEADLESS of main.c, and RTC /INT is wired to RA3 instead of SW2.
+//  - Frame: SOF, type, length, payload, checksum
+//    The checksum makes the sum of type, length, payload and itself zero.
+//  - A sleeping unit is woken up by UART_WAKE and takes the frame after
+//    UART_WAKE_MS (auto-wake of the EUSART, the first byte is lost).
+
+//#define UART_TELEMETRY  // Status and settings over the EUSART
+
+#define UART_SOF        0x7e
+#define UART_WAKE       0x00    // byte to wake up, not a part of frame
+#define UART_WAKE_MS    5       // wait after UART_WAKE [ms]
+#define UART_PAYLOAD    15      // max length of payload (UART_STATUS_LEN)
+
+// Frame types
+#define UART_QUERY      'Q'     // host -> unit: no payload, status returns
+#define UART_CONFIG     'C'     // host -> unit: settings [+ time], status returns
+#define UART_STATUS     'S'     // unit -> host: see below
+
+// UART_CONFIG payload
+//   0:use alarm(0/1) 1:alarm minute 2:alarm hour 3:power on time[sec](1-99)
+//   4-10 (optional): sec, min, hour, day, weekday, month, year(00-99)
+#define UART_CONFIG_LEN 4
+#define UART_CONFIG_TIME_LEN 11
+
+// UART_STATUS payload
+//   0-6:  sec, min, hour, day, weekday, month, year(00-99)
+//   7:use alarm 8:alarm minute 9:alarm hour 10:power on time[sec]
+//   11-12: pump runs since reset (little endian)
+//   13: status (flashes of main.c) 14: bad frames since reset
+#define UART_STATUS_LEN 15
+
+// Ring buffers (power of 2, one entry is kept empty).
+// RX holds the longest frame to receive (15 bytes) while the loop waits.
+#define UART_TX_SIZE    8
+#define UART_RX_SIZE    16
+
+#ifdef UART_TELEMETRY
+extern unsigned char uart_bad_frames;
+extern unsigned char uart_frame[UART_PAYLOAD];
+extern unsigned char uart_frame_len;
+
+void uart_init(void);
+void uart_interrupt(void);
+void uart_send_frame(char type, const char *data, char len);
+char uart_receive_frame(void);
+char uart_busy(void);
+void uart_sleep(void);
+#endif
+
+#endif
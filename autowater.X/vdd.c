@@ -0,0 +1,59 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+
+// Supply voltage monitor (see vdd.h)
+
+#include "hal.h"
+#include "delay.h"
+#include "vdd.h"
+
+#ifdef VDD_MONITOR
+
+/**
+ * !@brief Measure the supply voltage
+ *
+ * Leaves FVR and the ADC off. The ADC settings are the same as soil.c.
+ * @return Reading of FVR (see VDD_ADC()), higher on a lower VDD
+ */
+unsigned short vdd_read(void)
+{
+    unsigned short sum = 0;
+
+    FVRCON = 0b10000001;                // FVREN, 1.024V to the ADC
+    ADCON1 = 0b10010000;                // right justified, Fosc/8 (TAD 1us), VDD
+    ADCON0 = (0b11111 << 2) | 1;        // FVR, ADON
+    while (FVRCONbits.FVRRDY == 0) {
+        HAL_POLL();
+    }
+    for (char i=0; i<VDD_SAMPLES; i++) {
+        __delay_us(5);                  // acquisition
+        ADCON0bits.GO_nDONE = 1;
+        while (ADCON0bits.GO_nDONE) {
+            HAL_POLL();
+        }
+        sum += ((unsigned short)ADRESH << 8) | ADRESL;
+    }
+    ADCON0 = 0;
+    FVRCON = 0;
+    return sum / VDD_SAMPLES;
+}
+#endif
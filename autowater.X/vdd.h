@@ -0,0 +1,49 @@
+/******************************************************************************
+ * Copyright (c) 2014 Satoshi Ikeda
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *****************************************************************************/
+#ifndef _VDD_H_
+#define _VDD_H_
+
+// Supply voltage monitor
+//  - The ADC converts the fixed voltage reference (FVR 1.024V) with VDD as
+//    the reference, so the reading rises as VDD falls:
+//      reading = 1023 * 1.024V / VDD
+//  - Compare the reading with VDD_ADC() of the thresholds, no division at
+//    run time.
+//  - FVR and the ADC are on only for the measurement (about 100us).
+//  - main.c measures at start up and on every wake up by the switches or
+//    the alarm, and on a low supply shortens the idle time, refreshes the
+//    display less often and shows the low battery.
+
+//#define VDD_MONITOR     // Adapt the power policy to the supply voltage
+
+#define VDD_LOW_MV      3000    // below: power saving
+#define VDD_EMPTY_MV    2700    // below: more saving (BOR is 2.5V)
+
+#define VDD_FVR_MV      1024    // FVR of the ADC (ADFVR = 01)
+#define VDD_SAMPLES     4       // conversions to average (power of 2)
+
+// Reading of vdd_read() at the supply voltage mv [mV]
+#define VDD_ADC(mv)     ((unsigned short)(1023UL * VDD_FVR_MV / (mv)))
+
+unsigned short vdd_read(void);
+
+#endif